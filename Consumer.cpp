@@ -2,7 +2,10 @@
 // Created by kishanp on 12/3/18.
 //
 
+#include <algorithm>
 #include <istream>
+#include <new>
+#include <sstream>
 #include <thread>
 
 #include "Consumer.hpp"
@@ -13,29 +16,172 @@ void Consumer::run() {
 
   std::string message;
   Interpreter interp;
+  interp.setInterrupt(interrupt);
+  interp.setLimits(limits);
+
+  /// A partial result is only built once the interval has passed
+  std::chrono::steady_clock::time_point lastPartial;
+  if (streaming) {
+    Progress progress;
+    progress.wanted = [this, &lastPartial]() {
+      return std::chrono::steady_clock::now() - lastPartial >= streamInterval;
+    };
+    progress.report = [this, &lastPartial](const Expression &partial) {
+      lastPartial = std::chrono::steady_clock::now();
+      reply(Answer(partial, true));
+    };
+    interp.setProgress(progress);
+  }
 
   while (1) {
     incomingMB->wait_and_pop(message);
     if (message == "%stop") {
-      outgoingMB->push(Expression("Threading Command", true));
+      reply(Expression("Threading Command", true));
       return;
     } else if (message == "%start") {
-      outgoingMB->push(Expression("Threading Command", true));
+      reply(Expression("Threading Command", true));
+    } else if (message == "%reset") {
+      interp.reset();
+      reply(Expression("Threading Command", true));
+      continue;
     }
 
-    std::istringstream iss(message);
+    if (interrupt != nullptr)
+      interrupt->store(false);
+    lastPartial = std::chrono::steady_clock::now();
+    reply(evaluate(interp, message));
+  }
+}
+
+void Consumer::reply(const Answer &answer) {
+
+  outgoingMB->push(answer);
+  if (notify)
+    notify();
+}
+
+Expression Consumer::submit(const std::string &message, Priority priority) {
+
+  if (!incomingMB->push(message, priority))
+    return Expression("Error: interpreter kernel busy", false);
+  return Expression();
+}
+
+Expression Consumer::evaluate(Interpreter &interp, const std::string &message) {
 
-    if (!interp.parseStream(iss)) {
-      outgoingMB->push(Expression("Invalid Expression. Could not parse.", false));
+  std::istringstream iss(message);
+
+  if (!interp.parseStream(iss)) {
+    return Expression("Invalid Expression. Could not parse.", false);
+  }
+
+  try {
+    return interp.evaluate();
+  }
+  catch (const SemanticError &ex) {
+    return Expression(ex.what(), false);
+  }
+  /// Any other failure, such as running out of memory, is also an error of
+  /// the request; an exception leaving the kernel thread would end the process
+  catch (const std::bad_alloc &) {
+    return Expression("Error: evaluation ran out of memory", false);
+  }
+  catch (const std::exception &ex) {
+    return Expression(std::string("Error: ") + ex.what(), false);
+  }
+}
+
+bool IncomingMail::push(const std::string &message, Priority priority, std::size_t session) {
+  std::unique_lock<std::mutex> lock(the_mutex);
+  Lane &lane = lanes[static_cast<int>(priority)];
+  if (full(lane)) {
+    if (policy == OverflowPolicy::Reject) {
+      lane.stats.rejected++;
+      return false;
+    } else if (policy == OverflowPolicy::DropOldest) {
+      lane.messages.pop();
+      lane.stats.dropped++;
     } else {
-      try {
-        Expression exp = interp.evaluate();
-        outgoingMB->push(exp);
-      }
-      catch (const SemanticError &ex) {
-        outgoingMB->push(Expression(ex.what(), false));
+      lane.stats.blocked++;
+      while (full(lane)) {
+        the_not_full.wait(lock);
       }
     }
+  }
 
+  Request request;
+  request.program = message;
+  request.session = session;
+  request.queued = std::chrono::steady_clock::now();
+  lane.messages.push(std::move(request));
+  lane.stats.highWater = std::max(lane.stats.highWater, lane.messages.size());
+  lock.unlock();
+  the_condition_variable.notify_one();
+  return true;
+}
+
+bool IncomingMail::empty() const {
+  std::lock_guard<std::mutex> lock(the_mutex);
+  return lanes[0].messages.empty() && lanes[1].messages.empty();
+}
+
+bool IncomingMail::try_pop(std::string &popped_value) {
+  Request request;
+  if (!try_pop(request))
+    return false;
+
+  popped_value = std::move(request.program);
+  return true;
+}
+
+void IncomingMail::wait_and_pop(std::string &popped_value) {
+  Request request;
+  wait_and_pop(request);
+  popped_value = std::move(request.program);
+}
+
+bool IncomingMail::try_pop(Request &popped_value) {
+  std::lock_guard<std::mutex> lock(the_mutex);
+  if (lanes[0].messages.empty() && lanes[1].messages.empty()) {
+    return false;
+  }
+
+  pop(popped_value);
+  the_not_full.notify_all();
+  return true;
+}
+
+void IncomingMail::wait_and_pop(Request &popped_value) {
+  std::unique_lock<std::mutex> lock(the_mutex);
+  while (lanes[0].messages.empty() && lanes[1].messages.empty()) {
+    the_condition_variable.wait(lock);
   }
+
+  pop(popped_value);
+  lock.unlock();
+  the_not_full.notify_all();
+}
+
+LaneStats IncomingMail::stats(Priority priority) const {
+  std::lock_guard<std::mutex> lock(the_mutex);
+  return lanes[static_cast<int>(priority)].stats;
+}
+
+void IncomingMail::pop(Request &popped_value) {
+
+  Lane &interactive = lanes[static_cast<int>(Priority::Interactive)];
+  Lane &batch = lanes[static_cast<int>(Priority::Batch)];
+
+  bool takeBatch = interactive.messages.empty() || (!batch.messages.empty() && streak >= batchEvery);
+  Lane &lane = takeBatch ? batch : interactive;
+  streak = takeBatch ? 0 : streak + 1;
+
+  double wait = std::chrono::duration<double>(std::chrono::steady_clock::now() - lane.messages.front().queued).count();
+  popped_value = std::move(lane.messages.front());
+  lane.messages.pop();
+
+  lane.stats.popped++;
+  lane.waitTotal += wait;
+  lane.stats.meanWait = lane.waitTotal / lane.stats.popped;
+  lane.stats.maxWait = std::max(lane.stats.maxWait, wait);
 }
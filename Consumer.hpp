@@ -6,28 +6,185 @@
 #define PLOTSCRIPT_CONSUMER_HPP
 
 #include "MessageQueue.hpp"
+#include "budget.hpp"
 #include "expression.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
 #include <string>
 
-// define the mailbox as out thread-safe message queue
-typedef MessageQueue<std::string> IncomingMail;
-typedef MessageQueue<Expression> OutgoingMail;
+class Interpreter;
+
+// the class of a request, interactive requests are evaluated first
+enum class Priority { Interactive, Batch };
+
+// how long the requests of one priority waited to be evaluated
+struct LaneStats {
+  std::size_t popped = 0;    // requests taken from the lane
+  std::size_t highWater = 0; // most requests the lane has held at once
+  std::size_t rejected = 0;  // requests refused by the Reject policy
+  std::size_t dropped = 0;   // requests discarded by the DropOldest policy
+  std::size_t blocked = 0;   // pushes that waited under the Block policy
+  double meanWait = 0;       // mean seconds from push to pop
+  double maxWait = 0;        // longest seconds from push to pop
+};
+
+// a program waiting in an IncomingMail
+struct Request {
+  // the program, or a threading command such as %stop
+  std::string program;
+
+  // the ConsumerPool session the program belongs to, 0 for a stateless
+  // request; a Consumer has one session and ignores it
+  std::size_t session = 0;
+
+  // when the request was pushed, to measure how long it waited
+  std::chrono::steady_clock::time_point queued;
+};
+
+// thread-safe mailbox with a lane per priority; interactive requests are
+// popped first, but after batchEvery interactive requests in a row a
+// waiting batch request is popped so batch work is never starved. Each
+// lane holds up to capacity requests and applies policy when it is full
+class IncomingMail {
+ public:
+
+  // construct a mailbox, a capacity of 0 leaves each lane unbounded
+  explicit IncomingMail(std::size_t capacity = 0, OverflowPolicy policy = OverflowPolicy::Block,
+                        std::size_t batchEvery = 8)
+      : capacity(capacity), policy(policy), batchEvery(batchEvery) {}
+
+  // push message of session into the lane of priority, blocks while the
+  // lane is full under the Block policy, returns false if rejected
+  bool push(const std::string &message, Priority priority = Priority::Interactive, std::size_t session = 0);
+
+  // check if every lane is empty
+  bool empty() const;
+
+  // pop the next message to evaluate, return false if there is none
+  bool try_pop(std::string &popped_value);
+
+  // pop the next message to evaluate, blocks until there is one
+  void wait_and_pop(std::string &popped_value);
+
+  // pop the next request with its session, return false if there is none
+  bool try_pop(Request &popped_value);
+
+  // pop the next request with its session, blocks until there is one
+  void wait_and_pop(Request &popped_value);
+
+  // the waits of the requests of priority so far
+  LaneStats stats(Priority priority) const;
+
+ private:
+
+  struct Lane {
+    std::queue<Request> messages;
+    LaneStats stats;
+    double waitTotal = 0;
+  };
+
+  // pop from the lane the schedule picks, the lanes must not all be empty
+  void pop(Request &popped_value);
+
+  bool full(const Lane &lane) const {
+    return capacity != 0 && lane.messages.size() >= capacity;
+  }
+
+  Lane lanes[2];
+  std::size_t streak = 0;
+  const std::size_t capacity;
+  const OverflowPolicy policy;
+  const std::size_t batchEvery;
+  mutable std::mutex the_mutex;
+  std::condition_variable the_condition_variable;
+  std::condition_variable the_not_full;
+};
+
+// what a consumer sends back: the result of a request, or a partial result
+// of the request being evaluated, which its result follows. A ConsumerPool
+// sets the session of the request
+struct Answer {
+  Expression result;
+  bool partial = false;
+  std::size_t session = 0;
+
+  Answer() = default;
+  Answer(const Expression &r, bool p = false, std::size_t s = 0) : result(r), partial(p), session(s) {}
+};
+
+typedef MessageQueue<Answer> OutgoingMail;
+
+// the capacity of the mailboxes of an interactive kernel: requests beyond it
+// are rejected as the kernel being busy, and results beyond it hold the
+// kernel until they are read. A kernel rejects rather than block its front end
+const std::size_t KERNEL_MAILBOX_CAPACITY = 64;
+
+// the most list elements and estimated bytes of lists one evaluation of an
+// interactive kernel may create by default, so a program asking for more
+// memory than the machine has is an error rather than the end of the kernel
+const std::size_t KERNEL_NODE_LIMIT = std::size_t(1) << 25;
+const std::size_t KERNEL_BYTE_LIMIT = std::size_t(1) << 31;
 
 class Consumer {
 
  public:
 
   Consumer() = default;
-  Consumer(IncomingMail *i_MB, OutgoingMail *o_MB, std::size_t ConsumerID)
-      : incomingMB(i_MB), outgoingMB(o_MB), id(ConsumerID) {}
+  // interrupt, if given, is set by another thread to interrupt the evaluation
+  // running when it is set; it is cleared before each evaluation
+  Consumer(IncomingMail *i_MB, OutgoingMail *o_MB, std::size_t ConsumerID, std::atomic<bool> *interrupt = nullptr)
+      : incomingMB(i_MB), outgoingMB(o_MB), id(ConsumerID), interrupt(interrupt) {}
 
   void run();
 
+  /// set the limits on the resources each evaluation may use, before run;
+  /// by default the kernel node and byte limits and the default depth limit
+  void setLimits(const Limits &limits) { this->limits = limits; }
+
+  // set a function called on the consumer thread after each reply is
+  // pushed, so a reader can be woken instead of waiting on the mailbox
+  void setNotify(const std::function<void()> &notify) { this->notify = notify; }
+
+  // push partial results of long evaluations, such as a continuous-plot
+  // before its sampling is complete, at most once per interval and not
+  // before interval has passed since the evaluation began. A partial result
+  // is pushed as a partial Answer and is followed by the result. Call before run
+  void setStreaming(std::chrono::milliseconds interval) {
+    streaming = true;
+    streamInterval = interval;
+  }
+
+  /// push a request, returning an error Expression if the mailbox rejects it or NONE if it was taken
+  Expression submit(const std::string &message, Priority priority = Priority::Interactive);
+
+  /// parse and evaluate a message, returning the result or an error Expression
+  static Expression evaluate(Interpreter &interp, const std::string &message);
+
  private:
 
   IncomingMail *incomingMB;
   OutgoingMail *outgoingMB;
   std::size_t id;
+  std::atomic<bool> *interrupt = nullptr;
+  Limits limits = kernelLimits();
+  std::function<void()> notify;
+  bool streaming = false;
+  std::chrono::milliseconds streamInterval{0};
+
+  // push a reply and call notify
+  void reply(const Answer &answer);
+
+  // the default limits, with the kernel node and byte limits
+  static Limits kernelLimits() {
+    Limits limits;
+    limits.nodes = KERNEL_NODE_LIMIT;
+    limits.bytes = KERNEL_BYTE_LIMIT;
+    return limits;
+  }
 };
 
 #endif //PLOTSCRIPT_CONSUMER_HPP
@@ -0,0 +1,210 @@
+#include "ConsumerPool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+
+#include "interpreter.hpp"
+
+namespace {
+
+double seconds(std::chrono::steady_clock::duration duration) {
+  return std::chrono::duration<double>(duration).count();
+}
+
+}
+
+struct ConsumerPool::Worker {
+
+  MessageQueue<Request> queue;
+
+  // requests handed to the worker and not yet evaluated
+  std::atomic<std::size_t> pending{0};
+
+  Limits limits;
+
+  std::thread thread;
+
+  // guards the statistics, written by the worker and read by stats()
+  mutable std::mutex statsMutex;
+  std::size_t requests = 0;
+  std::size_t sessions = 0;
+  double busy = 0;
+  double waitTotal = 0;
+  double waitMax = 0;
+  Usage peak;
+
+  void run(OutgoingMail *outgoingMB);
+};
+
+void ConsumerPool::Worker::run(OutgoingMail *outgoingMB) {
+
+  std::map<std::size_t, Interpreter> interpreters;
+  Request request;
+
+  while (true) {
+    queue.wait_and_pop(request);
+    if (request.session == 0 && request.program == "%stop")
+      return;
+
+    auto start = std::chrono::steady_clock::now();
+
+    Answer reply(Expression("Threading Command", true), false, request.session);
+    Usage usage;
+    /// Any failure becomes the reply, an exception leaving the thread would end the process
+    try {
+      if (request.program == "%close") {
+        interpreters.erase(request.session);
+      } else if (request.session == 0) {
+        Interpreter interp;
+        interp.setLimits(limits);
+        reply.result = Consumer::evaluate(interp, request.program);
+        usage = interp.usage();
+      } else if (request.program == "%reset") {
+        interpreters[request.session].reset();
+      } else {
+        Interpreter &interp = interpreters[request.session];
+        interp.setLimits(limits);
+        reply.result = Consumer::evaluate(interp, request.program);
+        usage = interp.usage();
+      }
+    } catch (const std::exception &ex) {
+      reply.result = Expression(std::string("Error: ") + ex.what(), false);
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    {
+      std::lock_guard<std::mutex> lock(statsMutex);
+      double wait = seconds(start - request.queued);
+      requests++;
+      busy += seconds(end - start);
+      waitTotal += wait;
+      waitMax = std::max(waitMax, wait);
+      peak.steps = std::max(peak.steps, usage.steps);
+      peak.depth = std::max(peak.depth, usage.depth);
+      peak.nodes = std::max(peak.nodes, usage.nodes);
+      peak.bytes = std::max(peak.bytes, usage.bytes);
+    }
+    pending--;
+
+    outgoingMB->push(reply);
+  }
+}
+
+ConsumerPool::ConsumerPool(IncomingMail *i_MB, OutgoingMail *o_MB, std::size_t workers, const Limits &limits)
+    : incomingMB(i_MB), outgoingMB(o_MB) {
+
+  /// Build the shared startup environment before any request is taken
+  Interpreter warm;
+
+  for (std::size_t i = 0; i < std::max<std::size_t>(workers, 1); ++i) {
+    this->workers.emplace_back(new Worker);
+    Worker *worker = this->workers.back().get();
+    worker->limits = limits;
+    worker->thread = std::thread(&Worker::run, worker, outgoingMB);
+  }
+
+  started = std::chrono::steady_clock::now();
+  dispatcher = std::thread(&ConsumerPool::dispatch, this);
+}
+
+ConsumerPool::~ConsumerPool() {
+
+  stop();
+}
+
+void ConsumerPool::stop() {
+
+  if (dispatcher.joinable()) {
+    /// A mailbox that rejects when full takes the stop once a request is taken
+    while (!incomingMB->push("%stop", Priority::Batch))
+      std::this_thread::yield();
+    dispatcher.join();
+  }
+}
+
+std::vector<WorkerStats> ConsumerPool::stats() const {
+
+  double elapsed = seconds(std::chrono::steady_clock::now() - started);
+
+  std::vector<WorkerStats> result;
+  for (auto &worker:workers) {
+    std::lock_guard<std::mutex> lock(worker->statsMutex);
+    WorkerStats stats;
+    stats.requests = worker->requests;
+    stats.sessions = worker->sessions;
+    stats.utilization = elapsed > 0 ? worker->busy / elapsed : 0;
+    stats.meanWait = worker->requests > 0 ? worker->waitTotal / worker->requests : 0;
+    stats.maxWait = worker->waitMax;
+    stats.peak = worker->peak;
+    result.push_back(stats);
+  }
+
+  return result;
+}
+
+void ConsumerPool::dispatch() {
+
+  Request request;
+
+  while (true) {
+    incomingMB->wait_and_pop(request);
+
+    if (request.session == 0 && request.program == "%stop") {
+      /// The lanes may have held requests pushed before the stop
+      while (incomingMB->try_pop(request)) {
+        if (request.session != 0 || request.program != "%stop")
+          assign(request);
+      }
+
+      /// Each worker finishes what it was handed before it stops
+      request.program = "%stop";
+      request.session = 0;
+      for (auto &worker:workers)
+        worker->queue.push(request);
+      for (auto &worker:workers)
+        worker->thread.join();
+      return;
+    }
+
+    assign(request);
+  }
+}
+
+void ConsumerPool::assign(const Request &request) {
+
+  std::size_t index;
+  if (request.session == 0) {
+    index = leastLoaded();
+  } else {
+    auto bound = affinity.find(request.session);
+    if (bound == affinity.end()) {
+      index = leastLoaded();
+      affinity.emplace(request.session, index);
+      std::lock_guard<std::mutex> lock(workers[index]->statsMutex);
+      workers[index]->sessions++;
+    } else {
+      index = bound->second;
+    }
+    if (request.program == "%close") {
+      affinity.erase(request.session);
+      std::lock_guard<std::mutex> lock(workers[index]->statsMutex);
+      workers[index]->sessions--;
+    }
+  }
+
+  workers[index]->pending++;
+  workers[index]->queue.push(request);
+}
+
+std::size_t ConsumerPool::leastLoaded() const {
+
+  std::size_t index = 0;
+  for (std::size_t i = 1; i < workers.size(); ++i) {
+    if (workers[i]->pending < workers[index]->pending)
+      index = i;
+  }
+
+  return index;
+}
@@ -0,0 +1,109 @@
+/*! \file ConsumerPool.hpp
+Defines a pool of interpreter threads serving the requests of many sessions.
+ */
+#ifndef PLOTSCRIPT_CONSUMERPOOL_HPP
+#define PLOTSCRIPT_CONSUMERPOOL_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Consumer.hpp"
+#include "MessageQueue.hpp"
+#include "budget.hpp"
+
+/*! \struct WorkerStats
+\brief Describes the load on one worker of a ConsumerPool.
+ */
+struct WorkerStats {
+  /// number of requests evaluated
+  std::size_t requests = 0;
+
+  /// number of open sessions bound to the worker
+  std::size_t sessions = 0;
+
+  /// fraction of the time since the pool started spent evaluating
+  double utilization = 0;
+
+  /// mean seconds a request waited between being made and being evaluated
+  double meanWait = 0;
+
+  /// longest seconds a request waited between being made and being evaluated
+  double maxWait = 0;
+
+  /// the most of each resource one request has used
+  Usage peak;
+};
+
+/*! \class ConsumerPool
+\brief Evaluates requests from one mailbox on several interpreter threads.
+
+The pool serves the same mailboxes as a Consumer, reading the session of
+each request from the IncomingMail and setting it on each Answer. Each
+worker thread evaluates requests from a queue of its own. The pool takes
+requests from the incoming mailbox on a dispatch thread and hands each to
+a worker: the first request of a session binds the session to the worker
+with the fewest pending requests and the session keeps that worker, and so
+its definitions, until it is closed. Stateless requests, of session 0, go
+to the worker with the fewest pending requests and are evaluated in a
+fresh interpreter. A session's %reset drops its definitions and %close
+forgets it, each answered with a threading command. The program %stop of
+session 0 stops the pool.
+
+Interpreters start from the shared startup environment, which the pool
+builds before starting its threads so no request waits for it.
+ */
+class ConsumerPool {
+ public:
+
+  /*! Start a pool.
+    \param i_MB the mailbox to take requests from
+    \param o_MB the mailbox to push replies to
+    \param workers the number of interpreter threads, at least 1
+    \param limits the limits on the resources each request may use
+   */
+  ConsumerPool(IncomingMail *i_MB, OutgoingMail *o_MB, std::size_t workers, const Limits &limits = Limits());
+
+  ConsumerPool(const ConsumerPool &) = delete;
+  ConsumerPool &operator=(const ConsumerPool &) = delete;
+
+  /// stop the pool
+  ~ConsumerPool();
+
+  /// evaluate the requests already in the mailbox, then join every thread
+  void stop();
+
+  /// the load on each worker
+  std::vector<WorkerStats> stats() const;
+
+ private:
+
+  struct Worker;
+
+  IncomingMail *incomingMB;
+  OutgoingMail *outgoingMB;
+
+  std::vector<std::unique_ptr<Worker>> workers;
+
+  // the worker each open session is bound to, used by the dispatch thread only
+  std::map<std::size_t, std::size_t> affinity;
+
+  std::chrono::steady_clock::time_point started;
+
+  std::thread dispatcher;
+
+  // hand requests to workers until told to stop
+  void dispatch();
+
+  // hand request to the worker its session is bound to
+  void assign(const Request &request);
+
+  // the index of the worker with the fewest pending requests
+  std::size_t leastLoaded() const;
+};
+
+#endif //PLOTSCRIPT_CONSUMERPOOL_HPP
@@ -5,20 +5,60 @@
 #ifndef PLOTSCRIPT_MESSAGEQUEUE_HPP
 #define PLOTSCRIPT_MESSAGEQUEUE_HPP
 
+#include <algorithm>
+#include <cstddef>
 #include <queue>
 #include <mutex>
 #include <condition_variable>
 
+// what push does when a bounded queue is full
+enum class OverflowPolicy {
+  Block,     // wait until a message is popped
+  Reject,    // leave the queue unchanged and return false
+  DropOldest // discard the message at the front to make room
+};
+
+// counts describing how full a queue has been, to size its capacity
+struct QueueStats {
+  std::size_t size = 0;      // messages in the queue now
+  std::size_t highWater = 0; // most messages the queue has held at once
+  std::size_t pushed = 0;    // messages accepted
+  std::size_t rejected = 0;  // messages refused by the Reject policy
+  std::size_t dropped = 0;   // messages discarded by the DropOldest policy
+  std::size_t blocked = 0;   // pushes that waited under the Block policy
+};
+
 template<typename MessageType>
 class MessageQueue {
 public:
 
-  // push message into queue, blocks until available
-  void push(MessageType const &message) {
+  // construct a queue, a capacity of 0 is unbounded
+  explicit MessageQueue(std::size_t capacity = 0, OverflowPolicy policy = OverflowPolicy::Block)
+      : the_capacity(capacity), the_policy(policy) {}
+
+  // push message into queue, blocks until available, returns false if rejected
+  bool push(MessageType const &message) {
     std::unique_lock<std::mutex> lock(the_mutex);
+    if (full()) {
+      if (the_policy == OverflowPolicy::Reject) {
+        the_stats.rejected++;
+        return false;
+      } else if (the_policy == OverflowPolicy::DropOldest) {
+        the_queue.pop();
+        the_stats.dropped++;
+      } else {
+        the_stats.blocked++;
+        while (full()) {
+          the_not_full.wait(lock);
+        }
+      }
+    }
     the_queue.push(message);
+    the_stats.pushed++;
+    the_stats.highWater = std::max(the_stats.highWater, the_queue.size());
     lock.unlock();
     the_condition_variable.notify_one();
+    return true;
   }
 
   // check if queue is empty, blocks until available
@@ -29,13 +69,15 @@ public:
 
   // pop message from queue, return false if queue is empty
   bool try_pop(MessageType &popped_value) {
-    std::lock_guard<std::mutex> lock(the_mutex);
+    std::unique_lock<std::mutex> lock(the_mutex);
     if (the_queue.empty()) {
       return false;
     }
 
     popped_value = the_queue.front();
     the_queue.pop();
+    lock.unlock();
+    the_not_full.notify_one();
     return true;
   }
 
@@ -48,13 +90,32 @@ public:
 
     popped_value = the_queue.front();
     the_queue.pop();
+    lock.unlock();
+    the_not_full.notify_one();
+  }
+
+  // the counts so far, blocks until available
+  QueueStats stats() const {
+    std::lock_guard<std::mutex> lock(the_mutex);
+    QueueStats stats = the_stats;
+    stats.size = the_queue.size();
+    return stats;
   }
 
 private:
 
+  bool full() const {
+    return the_capacity != 0 && the_queue.size() >= the_capacity;
+  }
+
   std::queue<MessageType> the_queue;
   mutable std::mutex the_mutex;
   std::condition_variable the_condition_variable;
+  std::condition_variable the_not_full;
+
+  const std::size_t the_capacity;
+  const OverflowPolicy the_policy;
+  QueueStats the_stats;
 
 };
 
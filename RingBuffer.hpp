@@ -0,0 +1,211 @@
+/*! \file RingBuffer.hpp
+Defines a bounded lock-free queue for passing messages between threads.
+ */
+#ifndef PLOTSCRIPT_RINGBUFFER_HPP
+#define PLOTSCRIPT_RINGBUFFER_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/*! \class RingBuffer
+\brief A bounded multi-producer multi-consumer queue that moves its messages.
+
+Each slot of the ring holds a sequence number that says whether it is free
+for the producer, or filled for the consumer, of a given position, so a push
+or pop is one compare-and-swap on the position plus a move, and producers and
+consumers touch different cache lines. A thread that finds the queue full
+(or empty) spins, then yields, and only then blocks on a condition variable,
+which the other side signals only when some thread is blocked. Unlike
+MessageQueue, messages are moved in and out rather than copied.
+ */
+template<typename MessageType>
+class RingBuffer {
+public:
+
+  /// construct a queue holding at least capacity messages, rounded up to a power of two
+  explicit RingBuffer(std::size_t capacity = 1024) : the_cells(roundUp(capacity)), the_mask(the_cells.size() - 1) {
+    for (std::size_t i = 0; i < the_cells.size(); ++i)
+      the_cells[i].sequence.store(i, std::memory_order_relaxed);
+  }
+
+  RingBuffer(const RingBuffer &) = delete;
+  RingBuffer &operator=(const RingBuffer &) = delete;
+
+  /// the number of messages the queue holds when full
+  std::size_t capacity() const noexcept {
+    return the_cells.size();
+  }
+
+  /// check if queue is empty, the answer may be stale by the time it is used
+  bool empty() const noexcept {
+    return the_enqueue.load(std::memory_order_acquire) == the_dequeue.load(std::memory_order_acquire);
+  }
+
+  /// push message into queue, return false and leave message unchanged if queue is full
+  bool try_push(MessageType &&message) {
+    if (!enqueue(message))
+      return false;
+    wake(the_consumers, false);
+    return true;
+  }
+
+  /// push message into queue, blocks until there is room
+  void push(MessageType &&message) {
+    waitFor(the_producers, [&]() { return enqueue(message); });
+    wake(the_consumers, false);
+  }
+
+  /// push messages from [first, first + count) until queue is full, return the number pushed
+  std::size_t push_n(MessageType *first, std::size_t count) {
+    std::size_t pushed = 0;
+    while (pushed < count && enqueue(first[pushed]))
+      ++pushed;
+    if (pushed > 0)
+      wake(the_consumers, pushed > 1);
+    return pushed;
+  }
+
+  /// pop message from queue, return false if queue is empty
+  bool try_pop(MessageType &popped_value) {
+    if (!dequeue(popped_value))
+      return false;
+    wake(the_producers, false);
+    return true;
+  }
+
+  /// pop message from queue, blocks until the queue is nonempty
+  void wait_and_pop(MessageType &popped_value) {
+    waitFor(the_consumers, [&]() { return dequeue(popped_value); });
+    wake(the_producers, false);
+  }
+
+  /// pop up to count messages into [first, first + count), return the number popped
+  std::size_t pop_n(MessageType *first, std::size_t count) {
+    std::size_t popped = 0;
+    while (popped < count && dequeue(first[popped]))
+      ++popped;
+    if (popped > 0)
+      wake(the_producers, popped > 1);
+    return popped;
+  }
+
+private:
+
+  // number of failed attempts before yielding, and before blocking
+  static const unsigned SPINS = 64;
+  static const unsigned YIELDS = 64;
+
+  struct Cell {
+    std::atomic<std::size_t> sequence;
+    MessageType message;
+  };
+
+  // threads blocked on one side of the queue
+  struct Waiters {
+    std::atomic<std::size_t> count{0};
+    std::mutex mutex;
+    std::condition_variable condition;
+  };
+
+  static std::size_t roundUp(std::size_t capacity) {
+    std::size_t size = 2;
+    while (size < capacity)
+      size *= 2;
+    return size;
+  }
+
+  // move message into the next free cell, false if there is none
+  bool enqueue(MessageType &message) {
+    std::size_t position = the_enqueue.load(std::memory_order_relaxed);
+    while (true) {
+      Cell &cell = the_cells[position & the_mask];
+      std::size_t sequence = cell.sequence.load(std::memory_order_acquire);
+      std::intptr_t difference = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position);
+      if (difference == 0) {
+        if (the_enqueue.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+          cell.message = std::move(message);
+          cell.sequence.store(position + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (difference < 0) {
+        return false;
+      } else {
+        position = the_enqueue.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // move the message of the next filled cell out, false if there is none
+  bool dequeue(MessageType &message) {
+    std::size_t position = the_dequeue.load(std::memory_order_relaxed);
+    while (true) {
+      Cell &cell = the_cells[position & the_mask];
+      std::size_t sequence = cell.sequence.load(std::memory_order_acquire);
+      std::intptr_t difference = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position + 1);
+      if (difference == 0) {
+        if (the_dequeue.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+          message = std::move(cell.message);
+          cell.sequence.store(position + the_mask + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (difference < 0) {
+        return false;
+      } else {
+        position = the_dequeue.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // retry attempt until it succeeds, spinning, then yielding, then blocking
+  template<typename Attempt>
+  void waitFor(Waiters &waiters, Attempt attempt) {
+    for (unsigned i = 0; i < SPINS + YIELDS; ++i) {
+      if (attempt())
+        return;
+      if (i >= SPINS)
+        std::this_thread::yield();
+    }
+
+    std::unique_lock<std::mutex> lock(waiters.mutex);
+    waiters.count.fetch_add(1);
+    // pairs with the fence in wake, so either this attempt sees the change
+    // or the thread making it sees this thread waiting
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    while (!attempt())
+      waiters.condition.wait(lock);
+    waiters.count.fetch_sub(1);
+  }
+
+  // signal threads blocked on the other side, if there are any
+  void wake(Waiters &waiters, bool all) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiters.count.load(std::memory_order_relaxed) == 0)
+      return;
+    {
+      // a waiter holds the mutex from its last attempt until it waits
+      std::lock_guard<std::mutex> lock(waiters.mutex);
+    }
+    if (all)
+      waiters.condition.notify_all();
+    else
+      waiters.condition.notify_one();
+  }
+
+  std::vector<Cell> the_cells;
+  const std::size_t the_mask;
+
+  // positions of the next push and pop, on their own cache lines
+  alignas(64) std::atomic<std::size_t> the_enqueue{0};
+  alignas(64) std::atomic<std::size_t> the_dequeue{0};
+
+  Waiters the_producers;
+  Waiters the_consumers;
+};
+
+#endif //PLOTSCRIPT_RINGBUFFER_HPP
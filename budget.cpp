@@ -0,0 +1,74 @@
+#include "budget.hpp"
+
+#include <algorithm>
+#include <limits>
+
+#include "expression.hpp"
+#include "semantic_error.hpp"
+
+namespace {
+
+Usage combine(const Usage &a, const Usage &b) {
+  Usage result;
+  result.steps = std::max(a.steps, b.steps);
+  result.depth = std::max(a.depth, b.depth);
+  result.nodes = std::max(a.nodes, b.nodes);
+  result.bytes = std::max(a.bytes, b.bytes);
+  return result;
+}
+
+bool exceeds(std::size_t used, std::size_t limit) {
+  return limit != 0 && used > limit;
+}
+
+// a + b, or the largest size if that overflows
+std::size_t saturatingAdd(std::size_t a, std::size_t b) {
+  return a > std::numeric_limits<std::size_t>::max() - b ? std::numeric_limits<std::size_t>::max() : a + b;
+}
+
+}
+
+Budget::Budget(const Limits &limits) : m_limits(limits) {}
+
+const Limits &Budget::limits() const noexcept {
+  return m_limits;
+}
+
+void Budget::setLimits(const Limits &limits) noexcept {
+  m_limits = limits;
+}
+
+void Budget::start() noexcept {
+  m_peak = combine(m_peak, m_usage);
+  m_usage = Usage();
+  m_depth = 0;
+}
+
+const Usage &Budget::usage() const noexcept {
+  return m_usage;
+}
+
+Usage Budget::peak() const noexcept {
+  return combine(m_peak, m_usage);
+}
+
+void Budget::exceeded() const {
+
+  if (m_limits.steps != 0 && m_usage.steps > m_limits.steps)
+    throw LimitExceeded("Error: evaluation exceeded its step limit");
+  throw LimitExceeded("Error: evaluation exceeded its depth limit");
+}
+
+void Budget::charge(std::size_t nodes) {
+
+  /// A lazy list can describe more elements than a size_t of bytes counts
+  std::size_t bytes = nodes > std::numeric_limits<std::size_t>::max() / sizeof(Expression)
+                      ? std::numeric_limits<std::size_t>::max() : nodes * sizeof(Expression);
+  m_usage.nodes = saturatingAdd(m_usage.nodes, nodes);
+  m_usage.bytes = saturatingAdd(m_usage.bytes, bytes);
+
+  if (exceeds(m_usage.nodes, m_limits.nodes))
+    throw LimitExceeded("Error: evaluation exceeded its node limit");
+  if (exceeds(m_usage.bytes, m_limits.bytes))
+    throw LimitExceeded("Error: evaluation exceeded its memory limit");
+}
@@ -0,0 +1,135 @@
+/*! \file budget.hpp
+Defines the resource limits placed on a single evaluation.
+ */
+#ifndef BUDGET_HPP
+#define BUDGET_HPP
+
+#include <cstddef>
+
+/*! \struct Limits
+\brief The most an evaluation may use of each resource, 0 for no limit.
+ */
+struct Limits {
+  /// number of expressions evaluated
+  std::size_t steps = 0;
+
+  /// depth of nested evaluation, bounds the C++ stack used; by default
+  /// well inside a 8 MB thread stack so runaway recursion is an error
+  std::size_t depth = 2000;
+
+  /// number of list elements created
+  std::size_t nodes = 0;
+
+  /// estimated bytes of the lists created
+  std::size_t bytes = 0;
+};
+
+/*! \struct Usage
+\brief How much of each resource an evaluation used.
+ */
+struct Usage {
+  /// number of expressions evaluated
+  std::size_t steps = 0;
+
+  /// deepest nesting of evaluation reached
+  std::size_t depth = 0;
+
+  /// number of list elements created
+  std::size_t nodes = 0;
+
+  /// estimated bytes of the lists created
+  std::size_t bytes = 0;
+};
+
+/*! \class Budget
+\brief Counts the resources used by an evaluation against its Limits.
+
+List elements are counted where lists are made: by the list special form,
+by map, and in the results of procedures. A list is counted once however
+many copies share its storage, and a lazy list is counted as if it were
+materialized. Bytes are estimated from the size of an Expression.
+ */
+class Budget {
+ public:
+
+  /// Construct a budget with the given limits
+  explicit Budget(const Limits &limits = Limits());
+
+  /// the limits
+  const Limits &limits() const noexcept;
+
+  /// replace the limits, taking effect at the next start
+  void setLimits(const Limits &limits) noexcept;
+
+  /// begin counting a new evaluation
+  void start() noexcept;
+
+  /// the resources used by the current or last evaluation
+  const Usage &usage() const noexcept;
+
+  /// the most of each resource any evaluation has used
+  Usage peak() const noexcept;
+
+  /*! Count an evaluation step one level deeper, inline as it runs for
+    every expression evaluated.
+    \throws LimitExceeded if the step or depth limit is exceeded
+   */
+  void enter() {
+    m_usage.steps++;
+    if (++m_depth > m_usage.depth)
+      m_usage.depth = m_depth;
+    if ((m_limits.steps != 0 && m_usage.steps > m_limits.steps)
+        || (m_limits.depth != 0 && m_depth > m_limits.depth))
+      exceeded();
+  }
+
+  /// leave the level entered by the matching call to enter
+  void leave() noexcept {
+    m_depth--;
+  }
+
+  /*! Count the creation of list elements.
+    \param nodes the number of elements
+    \throws LimitExceeded if the node or byte limit is exceeded
+   */
+  void charge(std::size_t nodes);
+
+  /*! \class Frame
+  \brief Enters a budget for the lifetime of the frame, if there is one.
+   */
+  class Frame {
+   public:
+    explicit Frame(Budget *budget) : m_budget(budget) {
+      if (m_budget != nullptr)
+        m_budget->enter();
+    }
+
+    ~Frame() {
+      if (m_budget != nullptr)
+        m_budget->leave();
+    }
+
+    Frame(const Frame &) = delete;
+    Frame &operator=(const Frame &) = delete;
+
+   private:
+    Budget *m_budget;
+  };
+
+ private:
+
+  Limits m_limits;
+
+  Usage m_usage;
+
+  // the most used by the evaluations before the current one
+  Usage m_peak;
+
+  // the current depth, m_usage.depth is the deepest reached
+  std::size_t m_depth = 0;
+
+  // throw for the step or depth limit enter found exceeded
+  [[noreturn]] void exceeded() const;
+};
+
+#endif
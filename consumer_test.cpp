@@ -3,33 +3,318 @@
 //
 
 #include "Consumer.hpp"
+#include "ConsumerPool.hpp"
+#include "interpreter.hpp"
 #include "catch.hpp"
+#include <atomic>
+#include <map>
 #include <thread>
+#include <vector>
 
 TEST_CASE("Test Constructor", "[consumer]") {
 
-  MessageQueue<std::string> in;
-  MessageQueue<Expression> out;
+  IncomingMail in;
+  OutgoingMail out;
   Consumer worker(&in, &out, 1);
 
 }
 
 TEST_CASE("Test Run", "[consumer]") {
 
-  MessageQueue<std::string> in;
-  MessageQueue<Expression> out;
+  IncomingMail in;
+  OutgoingMail out;
   Consumer worker(&in, &out, 1);
 
   std::thread th1(&Consumer::run, worker);
 
   in.push("(+ 1 2)");
 
-  Expression result;
-  out.wait_and_pop(result);
+  Answer answer;
+  out.wait_and_pop(answer);
 
   in.push("%stop");
   th1.join();
 
-  CHECK(result == Expression(3.));
+  CHECK(answer.result == Expression(3.));
 
-}
\ No newline at end of file
+}
+TEST_CASE("Test Reset", "[consumer]") {
+
+  IncomingMail in;
+  OutgoingMail out;
+  Consumer worker(&in, &out, 1);
+
+  std::thread th1(&Consumer::run, worker);
+
+  Answer answer;
+  in.push("(define a 1)");
+  out.wait_and_pop(answer);
+
+  /// the thread keeps running and forgets the definition
+  in.push("%reset");
+  out.wait_and_pop(answer);
+  in.push("a");
+  out.wait_and_pop(answer);
+  CHECK(answer.result.head().isError());
+
+  in.push("(define a 2)");
+  out.wait_and_pop(answer);
+  CHECK(answer.result == Expression(2.));
+
+  in.push("%stop");
+  out.wait_and_pop(answer);
+  th1.join();
+}
+
+TEST_CASE("Test Kernel Limits", "[consumer]") {
+
+  IncomingMail in;
+  OutgoingMail out;
+  Consumer worker(&in, &out, 1);
+
+  std::thread th1(&Consumer::run, worker);
+
+  /// a list larger than memory is an error of the request, not the kernel's end
+  Answer answer;
+  in.push("(map sin (range 0 1e17 1))");
+  out.wait_and_pop(answer);
+  CHECK(answer.result == Expression("Error: evaluation exceeded its node limit", false));
+
+  in.push("(+ 1 2)");
+  out.wait_and_pop(answer);
+  CHECK(answer.result == Expression(3.));
+
+  in.push("%stop");
+  out.wait_and_pop(answer);
+  th1.join();
+
+  /// without limits the same request is evaluated a little at a time
+  Interpreter interp;
+  Limits limits;
+  limits.steps = 100000;
+  interp.setLimits(limits);
+  CHECK(Consumer::evaluate(interp, "(map sin (range 0 1e17 1))")
+            == Expression("Error: evaluation exceeded its step limit", false));
+}
+
+TEST_CASE("Test Notify", "[consumer]") {
+
+  IncomingMail in;
+  OutgoingMail out;
+  Consumer worker(&in, &out, 1);
+
+  /// each reply is in the mailbox by the time notify is called
+  std::atomic<std::size_t> notified{0};
+  std::atomic<bool> waiting{true};
+  worker.setNotify([&]() {
+    if (out.empty())
+      waiting = false;
+    notified++;
+  });
+
+  std::thread th1(&Consumer::run, worker);
+
+  in.push("(+ 1 2)");
+  in.push("(* 2 3)");
+  in.push("%stop");
+  th1.join();
+
+  CHECK(notified == 3);
+  CHECK(waiting);
+
+  Answer answer;
+  REQUIRE(out.try_pop(answer));
+  CHECK(answer.result == Expression(3.));
+  REQUIRE(out.try_pop(answer));
+  CHECK(answer.result == Expression(6.));
+}
+
+TEST_CASE("Test Streaming", "[consumer]") {
+
+  IncomingMail in;
+  OutgoingMail out;
+  Consumer worker(&in, &out, 1);
+  worker.setStreaming(std::chrono::milliseconds(0));
+
+  std::thread th1(&Consumer::run, worker);
+
+  /// A curve refined in several passes is sent before each pass
+  in.push("(begin (define f (lambda (x) (sin x))) (continuous-plot f (list -3 3)))");
+  std::vector<Expression> results;
+  Answer answer;
+  do {
+    out.wait_and_pop(answer);
+    results.push_back(answer.result);
+  } while (answer.partial);
+
+  const Expression &result = answer.result;
+  REQUIRE(results.size() > 1);
+  CHECK_FALSE(result.head().isError());
+  for (std::size_t i = 0; i + 1 < results.size(); ++i) {
+    CHECK(results[i].isList());
+    CHECK(results[i].getTail().size() == result.getTail().size());
+    CHECK(results[i].getTail().back().getGeometry()->size() < result.getTail().back().getGeometry()->size());
+  }
+
+  /// Results without partial steps are sent alone, whatever their properties
+  in.push("(set-property \"partial\" 1 (+ 1 2))");
+  out.wait_and_pop(answer);
+  CHECK(answer.result == Expression(3.));
+  CHECK_FALSE(answer.partial);
+
+  in.push("%stop");
+  out.wait_and_pop(answer);
+  th1.join();
+}
+
+TEST_CASE("Test Pool", "[consumer]") {
+
+  IncomingMail in;
+  OutgoingMail out;
+  ConsumerPool pool(&in, &out, 2);
+
+  /// sessions keep their definitions on their own worker
+  in.push("(define a 1)", Priority::Interactive, 1);
+  in.push("(define a 2)", Priority::Interactive, 2);
+  in.push("(+ a 10)", Priority::Interactive, 1);
+  in.push("(+ a 20)", Priority::Batch, 2);
+  in.push("a");
+
+  std::map<std::size_t, std::vector<Expression>> results;
+  for (int i = 0; i < 5; ++i) {
+    Answer answer;
+    out.wait_and_pop(answer);
+    CHECK_FALSE(answer.partial);
+    results[answer.session].push_back(answer.result);
+  }
+  CHECK(results[1].back() == Expression(11.));
+  CHECK(results[2].back() == Expression(22.));
+
+  /// stateless requests see no session's definitions
+  CHECK(results[0].back().head().isError());
+
+  in.push("%reset", Priority::Interactive, 1);
+  in.push("(define a 3)", Priority::Interactive, 1);
+  Answer answer;
+  out.wait_and_pop(answer);
+  CHECK(answer.result == Expression("Threading Command", true));
+  out.wait_and_pop(answer);
+  CHECK(answer.result == Expression(3.));
+  CHECK(answer.session == 1);
+
+  /// requests already in the mailbox are evaluated before the pool stops
+  in.push("(+ 1 2)", Priority::Batch, 3);
+  pool.stop();
+  out.wait_and_pop(answer);
+  CHECK(answer.result == Expression(3.));
+  CHECK(answer.session == 3);
+
+  std::vector<WorkerStats> stats = pool.stats();
+  REQUIRE(stats.size() == 2);
+  CHECK(stats[0].requests + stats[1].requests == 8);
+  CHECK(stats[0].sessions + stats[1].sessions == 3);
+  CHECK(stats[0].maxWait >= stats[0].meanWait);
+  CHECK(stats[0].peak.steps + stats[1].peak.steps > 0);
+}
+
+TEST_CASE("Test Priority Lanes", "[consumer]") {
+
+  IncomingMail in(0, OverflowPolicy::Block, 2);
+  in.push("b1", Priority::Batch);
+  in.push("b2", Priority::Batch);
+  in.push("i1");
+  in.push("i2");
+  in.push("i3");
+
+  /// interactive first, but batch is served after every two interactive
+  std::string message, order;
+  while (in.try_pop(message))
+    order += message + " ";
+  CHECK(order == "i1 i2 b1 i3 b2 ");
+
+  CHECK(in.stats(Priority::Interactive).popped == 3);
+  CHECK(in.stats(Priority::Batch).popped == 2);
+  CHECK(in.stats(Priority::Batch).highWater == 2);
+  CHECK(in.stats(Priority::Batch).maxWait >= in.stats(Priority::Batch).meanWait);
+
+  IncomingMail bounded(1, OverflowPolicy::Reject);
+  CHECK(bounded.push("(+ 1 2)", Priority::Batch));
+  CHECK_FALSE(bounded.push("(+ 1 2)", Priority::Batch));
+  CHECK(bounded.push("(+ 1 2)"));
+  CHECK(bounded.stats(Priority::Batch).rejected == 1);
+
+  /// a consumer answers a request its full mailbox rejects with an error
+  OutgoingMail out;
+  Consumer worker(&bounded, &out, 1);
+  CHECK(worker.submit("(+ 1 2)", Priority::Batch) == Expression("Error: interpreter kernel busy", false));
+  while (bounded.try_pop(message))
+    ;
+  CHECK(worker.submit("(+ 1 2)", Priority::Batch) == Expression());
+}
+
+TEST_CASE("Test Lane Overflow Policies", "[consumer]") {
+
+  /// the oldest request of the full lane makes room, the other lane is untouched
+  IncomingMail dropping(2, OverflowPolicy::DropOldest);
+  dropping.push("b1", Priority::Batch);
+  dropping.push("i1");
+  dropping.push("b2", Priority::Batch);
+  dropping.push("b3", Priority::Batch);
+  std::string message, order;
+  while (dropping.try_pop(message))
+    order += message + " ";
+  CHECK(order == "i1 b2 b3 ");
+  CHECK(dropping.stats(Priority::Batch).dropped == 1);
+
+  /// a push to a full lane waits for a pop
+  IncomingMail blocking(1, OverflowPolicy::Block);
+  blocking.push("first");
+  std::thread producer([&blocking]() { blocking.push("second"); });
+  while (blocking.stats(Priority::Interactive).blocked == 0)
+    std::this_thread::yield();
+  blocking.wait_and_pop(message);
+  CHECK(message == "first");
+  producer.join();
+  blocking.wait_and_pop(message);
+  CHECK(message == "second");
+}
+
+TEST_CASE("Test Interrupt", "[consumer]") {
+
+  IncomingMail in;
+  OutgoingMail out;
+  std::atomic<bool> interrupted(false);
+  Consumer worker(&in, &out, 1, &interrupted);
+
+  std::thread th1(&Consumer::run, worker);
+
+  /// define the procedures before any evaluation can be interrupted
+  Answer answer;
+  in.push("(begin (define f (lambda (x) (+ x 1))) (define g (lambda (x) (map f (range 0 1000 1)))))");
+  out.wait_and_pop(answer);
+
+  in.push("(map g (range 0 1000 1))");
+
+  /// keep setting the flag, the consumer clears it when evaluation starts
+  while (!out.try_pop(answer)) {
+    interrupted = true;
+    std::this_thread::yield();
+  }
+  CHECK(answer.result == Expression("Error: interrupted", false));
+
+  /// the interpreter keeps working and keeps its definitions
+  in.push("(g 1)");
+  while (!out.try_pop(answer)) {
+    interrupted = true;
+    std::this_thread::yield();
+  }
+  CHECK(answer.result == Expression("Error: interrupted", false));
+
+  in.push("(+ 1 2)");
+  out.wait_and_pop(answer);
+  CHECK(answer.result == Expression(3.));
+
+  in.push("%stop");
+  out.wait_and_pop(answer);
+  th1.join();
+}
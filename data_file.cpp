@@ -0,0 +1,494 @@
+#include "data_file.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <limits>
+#include <locale>
+#include <sstream>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "semantic_error.hpp"
+
+MappedFile::MappedFile(const std::string &path) {
+
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw SemanticError("Error: could not open file " + path);
+
+  struct stat info;
+  if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+    close(fd);
+    throw SemanticError("Error: could not read file " + path);
+  }
+
+  m_size = static_cast<std::size_t>(info.st_size);
+  if (m_size > 0) {
+    void *mapping = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping == MAP_FAILED) {
+      close(fd);
+      throw SemanticError("Error: could not map file " + path);
+    }
+    m_data = static_cast<const char *>(mapping);
+  }
+  close(fd);
+}
+
+MappedFile::~MappedFile() {
+  if (m_data != nullptr)
+    munmap(const_cast<char *>(m_data), m_size);
+}
+
+const char *MappedFile::data() const noexcept {
+  return m_data;
+}
+
+std::size_t MappedFile::size() const noexcept {
+  return m_size;
+}
+
+MappedSequence::MappedSequence(const std::shared_ptr<const MappedFile> &file, std::size_t offset,
+                               std::size_t count, std::size_t stride, ElementType type, bool swap)
+    : m_file(file), m_first(file->data() + offset), m_count(count), m_stride(stride), m_type(type), m_swap(swap) {}
+
+std::size_t MappedSequence::size() const noexcept {
+  return m_count;
+}
+
+double MappedSequence::at(std::size_t index) const noexcept {
+
+  // copy the bytes out since elements need not be aligned
+  const char *element = m_first + index * m_stride;
+  if (m_type == Float64Type || m_type == Int64Type || m_type == UInt64Type) {
+    std::uint64_t bits;
+    std::memcpy(&bits, element, sizeof(bits));
+    if (m_swap)
+      bits = __builtin_bswap64(bits);
+    if (m_type == Int64Type)
+      return static_cast<double>(static_cast<std::int64_t>(bits));
+    if (m_type == UInt64Type)
+      return static_cast<double>(bits);
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+
+  std::uint32_t bits;
+  std::memcpy(&bits, element, sizeof(bits));
+  if (m_swap)
+    bits = __builtin_bswap32(bits);
+  if (m_type == Int32Type)
+    return static_cast<double>(static_cast<std::int32_t>(bits));
+  if (m_type == UInt32Type)
+    return static_cast<double>(bits);
+  float value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+namespace {
+
+const double NaN = std::numeric_limits<double>::quiet_NaN();
+
+// powers of ten that are exact as doubles
+const double EXACT_POWERS[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                               1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+bool isDigit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+bool hostIsLittleEndian() {
+  const std::uint16_t probe = 1;
+  char first;
+  std::memcpy(&first, &probe, 1);
+  return first == 1;
+}
+
+// interpret a numpy type string such as "<f8", returning the element size
+std::size_t parseDescr(const std::string &descr, MappedSequence::ElementType &type, bool &swap) {
+
+  std::string code = descr;
+  bool little = hostIsLittleEndian();
+  if (!code.empty() && (code[0] == '<' || code[0] == '>' || code[0] == '=' || code[0] == '|')) {
+    little = code[0] == '<' ? true : (code[0] == '>' ? false : little);
+    code = code.substr(1);
+  }
+  swap = little != hostIsLittleEndian();
+
+  if (code == "f8")
+    type = MappedSequence::Float64Type;
+  else if (code == "f4")
+    type = MappedSequence::Float32Type;
+  else if (code == "i8")
+    type = MappedSequence::Int64Type;
+  else if (code == "i4")
+    type = MappedSequence::Int32Type;
+  else if (code == "u8")
+    type = MappedSequence::UInt64Type;
+  else if (code == "u4")
+    type = MappedSequence::UInt32Type;
+  else
+    throw SemanticError("Error: unsupported element type " + descr);
+
+  return code[1] == '8' ? 8 : 4;
+}
+
+// the text following key and its colon in a python dictionary literal
+std::string dictField(const std::string &header, const std::string &key) {
+  std::size_t at = header.find("'" + key + "'");
+  if (at == std::string::npos)
+    return std::string();
+  at = header.find(':', at);
+  if (at == std::string::npos)
+    return std::string();
+  at = header.find_first_not_of(' ', at + 1);
+  return at == std::string::npos ? std::string() : header.substr(at);
+}
+
+// sequences over the columns of an array of count elements starting at offset
+ArrayData mapArray(const std::shared_ptr<const MappedFile> &file, std::size_t offset,
+                   const std::vector<std::size_t> &shape, bool fortran, const std::string &descr,
+                   const std::string &path) {
+
+  MappedSequence::ElementType type;
+  bool swap;
+  std::size_t width = parseDescr(descr, type, swap);
+
+  // every extent and their product must fit in the elements after offset,
+  // checked by division so that a crafted shape cannot wrap the count
+  if (offset > file->size())
+    throw SemanticError("Error: file " + path + " is shorter than its array");
+  std::size_t available = (file->size() - offset) / width;
+  std::size_t count = 1;
+  for (auto extent:shape) {
+    if (extent > available || (extent != 0 && count > available / extent))
+      throw SemanticError("Error: file " + path + " is shorter than its array");
+    count *= extent;
+  }
+
+  ArrayData result;
+  result.shape = shape;
+  if (shape.size() == 1) {
+    result.columns.push_back(std::make_shared<MappedSequence>(file, offset, count, width, type, swap));
+  } else {
+    std::size_t rows = shape[0];
+    std::size_t columns = shape[1];
+    for (std::size_t c = 0; c < columns; ++c) {
+      if (fortran)
+        result.columns.push_back(std::make_shared<MappedSequence>(file, offset + c * rows * width, rows, width,
+                                                                  type, swap));
+      else
+        result.columns.push_back(std::make_shared<MappedSequence>(file, offset + c * width, rows,
+                                                                  columns * width, type, swap));
+    }
+  }
+  return result;
+}
+
+// true if only blanks stand between p and the next delimiter or the end of the line
+bool endsField(const char *p, const char *last, char delimiter) {
+  while (p < last && *p != delimiter && (*p == ' ' || *p == '\t' || *p == '\r'))
+    ++p;
+  return p == last || *p == delimiter;
+}
+
+// parse the selected fields of every line in [first, last), stopping after limit rows
+void parseRows(const char *first, const char *last, char delimiter, const std::vector<std::size_t> &columns,
+               std::size_t limit, std::vector<std::vector<double>> &result) {
+
+  std::size_t fields = 0;
+  for (auto column:columns)
+    fields = column + 1 > fields ? column + 1 : fields;
+
+  result.assign(columns.size(), std::vector<double>());
+  std::vector<double> row(fields);
+  std::size_t rows = 0;
+
+  const char *p = first;
+  while (p < last && (limit == 0 || rows < limit)) {
+    const char *end = static_cast<const char *>(std::memchr(p, '\n', last - p));
+    end = end == nullptr ? last : end;
+
+    // skip blank lines
+    const char *q = p;
+    while (q < end && (*q == ' ' || *q == '\t' || *q == '\r'))
+      ++q;
+    if (q == end) {
+      p = end + 1;
+      continue;
+    }
+
+    std::fill(row.begin(), row.end(), NaN);
+    std::size_t field = 0;
+    q = p;
+    while (q <= end && field < fields) {
+      while (q < end && (*q == ' ' || *q == '\t'))
+        ++q;
+      double value;
+      const char *next = parseNumber(q, end, value);
+      if (next != q && endsField(next, end, delimiter))
+        row[field] = value;
+      const char *delim = static_cast<const char *>(std::memchr(next, delimiter, end - next));
+      if (delim == nullptr)
+        break;
+      q = delim + 1;
+      ++field;
+    }
+
+    for (std::size_t i = 0; i < columns.size(); ++i)
+      result[i].push_back(row[columns[i]]);
+    ++rows;
+    p = end + 1;
+  }
+}
+
+}
+
+const char *parseNumber(const char *first, const char *last, double &value) noexcept {
+
+  const char *p = first;
+  bool negative = false;
+  if (p != last && (*p == '-' || *p == '+')) {
+    negative = *p == '-';
+    ++p;
+  }
+
+  std::uint64_t mantissa = 0;
+  int exponent = 0;
+  int digits = 0;
+  bool any = false;
+  bool truncated = false;
+
+  for (; p != last && isDigit(*p); ++p) {
+    any = true;
+    if (digits < 19) {
+      mantissa = mantissa * 10 + (*p - '0');
+      digits += mantissa != 0;
+    } else {
+      exponent++;
+      truncated = true;
+    }
+  }
+  if (p != last && *p == '.') {
+    ++p;
+    for (; p != last && isDigit(*p); ++p) {
+      any = true;
+      if (digits < 19) {
+        mantissa = mantissa * 10 + (*p - '0');
+        digits += mantissa != 0;
+        exponent--;
+      } else {
+        truncated = true;
+      }
+    }
+  }
+  if (!any)
+    return first;
+
+  if (p != last && (*p == 'e' || *p == 'E')) {
+    const char *e = p + 1;
+    bool negativeExponent = false;
+    if (e != last && (*e == '-' || *e == '+')) {
+      negativeExponent = *e == '-';
+      ++e;
+    }
+    if (e != last && isDigit(*e)) {
+      int written = 0;
+      for (; e != last && isDigit(*e); ++e)
+        written = written < 100000 ? written * 10 + (*e - '0') : written;
+      exponent += negativeExponent ? -written : written;
+      p = e;
+    }
+  }
+
+  // exact when both the mantissa and the power of ten are exact doubles
+  if (!truncated && mantissa < (std::uint64_t(1) << 53) && exponent >= -22 && exponent <= 22) {
+    double result = static_cast<double>(mantissa);
+    result = exponent < 0 ? result / EXACT_POWERS[-exponent] : result * EXACT_POWERS[exponent];
+    value = negative ? -result : result;
+    return p;
+  }
+
+  // otherwise fall back to the locale independent stream parser, which fails out of range
+  // leaving the largest double on overflow and zero on underflow
+  std::istringstream iss(std::string(first, p));
+  iss.imbue(std::locale::classic());
+  if (!(iss >> value)) {
+    double limit = std::abs(value) >= 1 ? std::numeric_limits<double>::infinity() : 0.;
+    value = negative ? -limit : limit;
+  }
+  return p;
+}
+
+ArrayData loadBinary(const std::string &path, const std::string &descr) {
+
+  auto file = std::make_shared<const MappedFile>(path);
+
+  MappedSequence::ElementType type;
+  bool swap;
+  std::size_t width = parseDescr(descr, type, swap);
+  if (file->size() % width != 0)
+    throw SemanticError("Error: size of file " + path + " not a multiple of the element size");
+
+  return mapArray(file, 0, {file->size() / width}, false, descr, path);
+}
+
+ArrayData loadNpy(const std::string &path) {
+
+  auto file = std::make_shared<const MappedFile>(path);
+  const char *data = file->data();
+  const std::string invalid = "Error: invalid npy file " + path;
+
+  /// Magic string, version and header length
+  if (file->size() < 10 || std::memcmp(data, "\x93NUMPY", 6) != 0)
+    throw SemanticError(invalid);
+  unsigned char major = static_cast<unsigned char>(data[6]);
+  std::size_t headerLength, headerStart;
+  if (major == 1) {
+    headerLength = static_cast<unsigned char>(data[8]) | static_cast<unsigned char>(data[9]) << 8;
+    headerStart = 10;
+  } else if ((major == 2 || major == 3) && file->size() >= 12) {
+    headerLength = 0;
+    for (int i = 3; i >= 0; --i)
+      headerLength = headerLength << 8 | static_cast<unsigned char>(data[8 + i]);
+    headerStart = 12;
+  } else {
+    throw SemanticError(invalid);
+  }
+  if (headerStart + headerLength > file->size())
+    throw SemanticError(invalid);
+  std::string header(data + headerStart, headerLength);
+
+  /// Header dictionary
+  std::string descr = dictField(header, "descr");
+  if (descr.size() < 2 || descr[0] != '\'' || descr.find('\'', 1) == std::string::npos)
+    throw SemanticError(invalid);
+  descr = descr.substr(1, descr.find('\'', 1) - 1);
+
+  bool fortran = dictField(header, "fortran_order").compare(0, 4, "True") == 0;
+
+  std::string shapeText = dictField(header, "shape");
+  if (shapeText.empty() || shapeText[0] != '(' || shapeText.find(')') == std::string::npos)
+    throw SemanticError(invalid);
+  std::vector<std::size_t> shape;
+  const char *p = shapeText.c_str() + 1;
+  const char *end = shapeText.c_str() + shapeText.find(')');
+  while (p < end) {
+    while (p < end && (*p == ' ' || *p == ','))
+      ++p;
+    if (p == end)
+      break;
+    if (!isDigit(*p))
+      throw SemanticError(invalid);
+    std::size_t extent = 0;
+    for (; p < end && isDigit(*p); ++p) {
+      if (extent > (std::numeric_limits<std::size_t>::max() - (*p - '0')) / 10)
+        throw SemanticError(invalid);
+      extent = extent * 10 + (*p - '0');
+    }
+    shape.push_back(extent);
+  }
+  if (shape.empty() || shape.size() > 2)
+    throw SemanticError("Error: only one and two dimensional arrays can be read from " + path);
+
+  return mapArray(file, headerStart + headerLength, shape, fortran, descr, path);
+}
+
+std::vector<std::vector<double>> loadCsv(const std::string &path, const CsvOptions &options) {
+
+  MappedFile file(path);
+  const char *first = file.data();
+  const char *last = first + file.size();
+  std::vector<std::vector<double>> result;
+
+  /// Inspect the first row for the column count and a header
+  const char *lineEnd = first == nullptr ? nullptr : static_cast<const char *>(std::memchr(first, '\n', file.size()));
+  lineEnd = lineEnd == nullptr ? last : lineEnd;
+  std::vector<bool> numeric;
+  for (const char *q = first; q != nullptr;) {
+    while (q < lineEnd && (*q == ' ' || *q == '\t'))
+      ++q;
+    bool empty = q == lineEnd || *q == options.delimiter || *q == '\r';
+    double value;
+    const char *next = parseNumber(q, lineEnd, value);
+    numeric.push_back(empty || (next != q && endsField(next, lineEnd, options.delimiter)));
+    const char *delim = static_cast<const char *>(std::memchr(next, options.delimiter, lineEnd - next));
+    q = delim == nullptr ? nullptr : delim + 1;
+  }
+
+  std::vector<std::size_t> columns = options.columns;
+  if (columns.empty()) {
+    for (std::size_t i = 0; i < numeric.size(); ++i)
+      columns.push_back(i);
+  }
+  if (columns.empty())
+    return result;
+
+  bool header = false;
+  for (auto column:columns)
+    header = header || (column < numeric.size() && !numeric[column]);
+  if (header)
+    first = lineEnd + 1 < last ? lineEnd + 1 : last;
+
+  /// Parse sequentially when a row limit bounds the work
+  std::size_t threads = options.threads != 0 ? options.threads : std::thread::hardware_concurrency();
+  const std::size_t minimumChunk = 1 << 20;
+  if (options.rowLimit != 0 || threads < 2 || static_cast<std::size_t>(last - first) < 2 * minimumChunk) {
+    parseRows(first, last, options.delimiter, columns, options.rowLimit, result);
+    return result;
+  }
+
+  /// Otherwise parse one chunk per thread, each ending at a line boundary
+  std::vector<const char *> bounds;
+  bounds.push_back(first);
+  std::size_t chunk = (last - first) / threads;
+  chunk = chunk > minimumChunk ? chunk : minimumChunk;
+  while (last - bounds.back() > static_cast<std::ptrdiff_t>(chunk)) {
+    const char *split = static_cast<const char *>(std::memchr(bounds.back() + chunk, '\n',
+                                                              last - bounds.back() - chunk));
+    if (split == nullptr)
+      break;
+    bounds.push_back(split + 1);
+  }
+  bounds.push_back(last);
+
+  /// A chunk that fails keeps its exception to be rethrown on this thread
+  std::vector<std::vector<std::vector<double>>> parts(bounds.size() - 1);
+  std::vector<std::exception_ptr> errors(parts.size());
+  std::vector<std::thread> workers;
+  for (std::size_t i = 0; i + 1 < bounds.size(); ++i) {
+    workers.emplace_back([&, i]() {
+      try {
+        parseRows(bounds[i], bounds[i + 1], options.delimiter, columns, 0, parts[i]);
+      } catch (...) {
+        errors[i] = std::current_exception();
+      }
+    });
+  }
+  for (auto &worker:workers)
+    worker.join();
+  for (auto &error:errors) {
+    if (error)
+      std::rethrow_exception(error);
+  }
+
+  result.assign(columns.size(), std::vector<double>());
+  for (std::size_t c = 0; c < columns.size(); ++c) {
+    std::size_t total = 0;
+    for (auto &part:parts)
+      total += part[c].size();
+    result[c].reserve(total);
+    for (auto &part:parts)
+      result[c].insert(result[c].end(), part[c].cbegin(), part[c].cend());
+  }
+
+  return result;
+}
@@ -0,0 +1,167 @@
+/*! \file data_file.hpp
+Defines the memory mapped file and the loaders built on it that bring
+numeric data into the interpreter.
+ */
+#ifndef DATA_FILE_HPP
+#define DATA_FILE_HPP
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "sequence.hpp"
+
+/*! \class MappedFile
+\brief A read-only memory mapping of a whole file.
+
+The mapping is released when the MappedFile is destroyed. An empty file maps
+to a null data pointer with size zero.
+ */
+class MappedFile {
+ public:
+
+  /*! Map a file read-only.
+    \param path the file to map
+    \throws SemanticError if the file cannot be opened or mapped
+   */
+  explicit MappedFile(const std::string &path);
+
+  /// Unmap the file
+  ~MappedFile();
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  /// the first byte of the file
+  const char *data() const noexcept;
+
+  /// the number of bytes in the file
+  std::size_t size() const noexcept;
+
+ private:
+
+  const char *m_data = nullptr;
+
+  std::size_t m_size = 0;
+};
+
+/*! \class MappedSequence
+\brief A Sequence reading fixed width numbers straight out of a MappedFile.
+
+Nothing is converted up front; each element is read from the mapping, and
+byte swapped if needed, only when it is accessed. The sequence shares
+ownership of the mapping so the file stays mapped while any list uses it.
+ */
+class MappedSequence : public Sequence {
+ public:
+
+  /// The element types that can be read
+  enum ElementType { Float64Type, Float32Type, Int64Type, Int32Type, UInt64Type, UInt32Type };
+
+  /*! Construct a sequence over part of a mapped file.
+    \param file the mapping holding the elements
+    \param offset the byte offset of the first element
+    \param count the number of elements
+    \param stride the number of bytes from one element to the next
+    \param type the type of each element
+    \param swap true if the bytes of each element are in the opposite order to the host
+   */
+  MappedSequence(const std::shared_ptr<const MappedFile> &file, std::size_t offset, std::size_t count,
+                 std::size_t stride, ElementType type, bool swap);
+
+  std::size_t size() const noexcept override;
+
+  double at(std::size_t index) const noexcept override;
+
+ private:
+
+  std::shared_ptr<const MappedFile> m_file;
+
+  const char *m_first;
+
+  std::size_t m_count;
+
+  std::size_t m_stride;
+
+  ElementType m_type;
+
+  bool m_swap;
+};
+
+/*! \struct ArrayData
+\brief An array loaded from a binary file, one sequence per column.
+ */
+struct ArrayData {
+  /// the extent of each dimension of the array
+  std::vector<std::size_t> shape;
+
+  /// the whole array if it has one dimension, otherwise one sequence per column
+  std::vector<std::shared_ptr<const Sequence>> columns;
+};
+
+/*! Map a file of raw numbers.
+
+  \param path the file to load
+  \param descr the element type as a numpy type string, for example "<f8" for
+  little endian float64 or "f4" for float32 in host byte order
+  \return a one dimensional array over the whole file
+  \throws SemanticError if the file cannot be mapped, the type is not supported
+  or the file size is not a multiple of the element size
+ */
+ArrayData loadBinary(const std::string &path, const std::string &descr);
+
+/*! Map a numpy .npy file.
+
+  Version 1, 2 and 3 headers are read for the element type, order and shape.
+  One and two dimensional arrays in C or Fortran order are supported.
+
+  \param path the file to load
+  \return the array, with one sequence per column if it has two dimensions
+  \throws SemanticError if the file cannot be mapped or is not a supported npy file
+ */
+ArrayData loadNpy(const std::string &path);
+
+/*! \struct CsvOptions
+\brief Selects what part of a CSV file is loaded.
+ */
+struct CsvOptions {
+  /// indices of the columns to load, all columns of the first row if empty
+  std::vector<std::size_t> columns;
+
+  /// maximum number of data rows to load, 0 for no limit
+  std::size_t rowLimit = 0;
+
+  /// character separating the fields of a row
+  char delimiter = ',';
+
+  /// number of threads parsing the file, 0 to use one per hardware thread
+  std::size_t threads = 0;
+};
+
+/*! Load numeric columns from a CSV file.
+
+  The file is mapped rather than read. Without a row limit it is split at line
+  boundaries into one chunk per thread and the chunks are parsed in parallel.
+  With a row limit it is parsed from the start and parsing stops at the limit,
+  so only the pages holding those rows are touched. A first row whose fields
+  are not numbers is treated as a header and skipped. Missing or non-numeric
+  fields load as NaN.
+
+  \param path the file to load
+  \param options the columns and rows to load
+  \return one vector of values per requested column
+  \throws SemanticError if the file cannot be read
+ */
+std::vector<std::vector<double>> loadCsv(const std::string &path, const CsvOptions &options);
+
+/*! Parse a decimal floating point number.
+
+  \param first the first character of the number
+  \param last one past the last character that may be read
+  \param value receives the number, infinite on overflow and zero on underflow
+  \return one past the last character of the number, or first if there is no number
+ */
+const char *parseNumber(const char *first, const char *last, double &value) noexcept;
+
+#endif
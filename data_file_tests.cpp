@@ -0,0 +1,170 @@
+#include "catch.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <string>
+
+#include "data_file.hpp"
+#include "semantic_error.hpp"
+
+double parse(const std::string &text, std::size_t &used) {
+  double value = 0;
+  used = parseNumber(text.data(), text.data() + text.size(), value) - text.data();
+  return value;
+}
+
+TEST_CASE("Test parsing numbers", "[data_file]") {
+
+  std::size_t used;
+  REQUIRE(parse("42", used) == 42);
+  REQUIRE(used == 2);
+  REQUIRE(parse("-3.25,", used) == -3.25);
+  REQUIRE(used == 5);
+  REQUIRE(parse("+.5", used) == 0.5);
+  REQUIRE(parse("1e3", used) == 1000);
+  REQUIRE(parse("2.5E-2", used) == 0.025);
+  REQUIRE(parse("0.1", used) == 0.1);
+  REQUIRE(parse("123456789012345678901234", used) == Approx(1.23456789012345678901234e23));
+  REQUIRE(used == 24);
+  REQUIRE(parse("1e-300", used) == Approx(1e-300));
+  REQUIRE(parse("7e", used) == 7);
+  REQUIRE(used == 1);
+  REQUIRE(parse("1e400", used) == std::numeric_limits<double>::infinity());
+  REQUIRE(used == 5);
+  REQUIRE(parse("-1e400", used) == -std::numeric_limits<double>::infinity());
+  REQUIRE(parse("1e-400", used) == 0);
+
+  parse("abc", used);
+  REQUIRE(used == 0);
+  parse("-", used);
+  REQUIRE(used == 0);
+}
+
+TEST_CASE("Test loading a csv file", "[data_file]") {
+
+  const std::string path = "data_file_test.csv";
+  {
+    std::ofstream out(path);
+    out << "x, y, label\n1, 2, a\n3,4,b\r\n\n5,,c\n7,8,d\n9 ,12abc,e";
+  }
+
+  CsvOptions options;
+  auto all = loadCsv(path, options);
+  REQUIRE(all.size() == 3);
+  REQUIRE(all[0] == std::vector<double>({1, 3, 5, 7, 9}));
+  REQUIRE(all[1][1] == 4);
+  REQUIRE(std::isnan(all[1][2]));
+  REQUIRE(std::isnan(all[1][4]));
+  REQUIRE(std::isnan(all[2][0]));
+
+  options.columns = {1, 0};
+  options.rowLimit = 2;
+  auto some = loadCsv(path, options);
+  REQUIRE(some.size() == 2);
+  REQUIRE(some[0] == std::vector<double>({2, 4}));
+  REQUIRE(some[1] == std::vector<double>({1, 3}));
+
+  std::remove(path.c_str());
+
+  REQUIRE_THROWS_AS(loadCsv(path, options), SemanticError);
+}
+
+TEST_CASE("Test loading a csv file in parallel", "[data_file]") {
+
+  const std::string path = "data_file_test.csv";
+  const std::size_t rows = 200000;
+  {
+    std::ofstream out(path);
+    for (std::size_t i = 0; i < rows; ++i)
+      out << i << "," << i * 0.5 << "," << -double(i) << "\n";
+  }
+
+  CsvOptions options;
+  options.threads = 4;
+  options.columns = {0, 2};
+  auto columns = loadCsv(path, options);
+  std::remove(path.c_str());
+
+  REQUIRE(columns.size() == 2);
+  REQUIRE(columns[0].size() == rows);
+  REQUIRE(columns[1].size() == rows);
+  bool ordered = true;
+  for (std::size_t i = 0; i < rows; ++i)
+    ordered = ordered && columns[0][i] == i && columns[1][i] == -double(i);
+  REQUIRE(ordered);
+}
+
+TEST_CASE("Test mapping a raw binary file", "[data_file]") {
+
+  const std::string path = "data_file_test.bin";
+  std::vector<double> values = {1.5, -2, 4, 1e300};
+  {
+    std::ofstream out(path, std::ios::binary);
+    out.write(reinterpret_cast<const char *>(values.data()), values.size() * sizeof(double));
+  }
+
+  ArrayData array = loadBinary(path, "f8");
+  REQUIRE(array.shape == std::vector<std::size_t>({4}));
+  REQUIRE(array.columns.size() == 1);
+  REQUIRE(array.columns[0]->size() == 4);
+  for (std::size_t i = 0; i < values.size(); ++i)
+    REQUIRE(array.columns[0]->at(i) == values[i]);
+
+  /// the mapping outlives the file name
+  std::remove(path.c_str());
+  REQUIRE(array.columns[0]->at(3) == 1e300);
+
+  REQUIRE_THROWS_AS(loadBinary(path, "f8"), SemanticError);
+}
+
+TEST_CASE("Test mapping an npy file", "[data_file]") {
+
+  const std::string path = "data_file_test.npy";
+  auto write = [&](const std::string &dict, const std::vector<std::int32_t> &values) {
+    std::string header = dict;
+    while ((10 + header.size() + 1) % 64 != 0)
+      header += ' ';
+    header += '\n';
+    std::ofstream out(path, std::ios::binary);
+    out.write("\x93NUMPY\x01\x00", 8);
+    out.put(static_cast<char>(header.size() & 0xff));
+    out.put(static_cast<char>(header.size() >> 8));
+    out << header;
+    out.write(reinterpret_cast<const char *>(values.data()), values.size() * sizeof(std::int32_t));
+  };
+
+  write("{'descr': '<i4', 'fortran_order': False, 'shape': (3, 2), }", {1, 2, 3, 4, 5, 6});
+  ArrayData rows = loadNpy(path);
+  REQUIRE(rows.shape == std::vector<std::size_t>({3, 2}));
+  REQUIRE(rows.columns.size() == 2);
+  REQUIRE(rows.columns[0]->size() == 3);
+  REQUIRE(rows.columns[0]->at(2) == 5);
+  REQUIRE(rows.columns[1]->at(0) == 2);
+
+  write("{'descr': '<i4', 'fortran_order': True, 'shape': (3, 2), }", {1, 2, 3, 4, 5, 6});
+  ArrayData columns = loadNpy(path);
+  REQUIRE(columns.columns[0]->at(2) == 3);
+  REQUIRE(columns.columns[1]->at(0) == 4);
+
+  write("{'descr': '>i4', 'fortran_order': False, 'shape': (1,), }", {0x01000000});
+  REQUIRE(loadNpy(path).columns[0]->at(0) == 1);
+
+  write("{'descr': '<i4', 'fortran_order': False, 'shape': (2, 2, 2), }", {1, 2, 3, 4, 5, 6, 7, 8});
+  REQUIRE_THROWS_AS(loadNpy(path), SemanticError);
+
+  write("{'descr': '<i4', 'fortran_order': False, 'shape': (4,), }", {1, 2});
+  REQUIRE_THROWS_AS(loadNpy(path), SemanticError);
+
+  /// shapes whose element count wraps or overflows are rejected
+  write("{'descr': '<i4', 'fortran_order': False, 'shape': (9223372036854775808, 2), }", {1, 2});
+  REQUIRE_THROWS_AS(loadNpy(path), SemanticError);
+  write("{'descr': '<i4', 'fortran_order': False, 'shape': (0, 9223372036854775808), }", {1, 2});
+  REQUIRE_THROWS_AS(loadNpy(path), SemanticError);
+  write("{'descr': '<i4', 'fortran_order': False, 'shape': (36893488147419103232,), }", {1, 2});
+  REQUIRE_THROWS_AS(loadNpy(path), SemanticError);
+
+  std::remove(path.c_str());
+}
@@ -0,0 +1,219 @@
+#include "decimate.hpp"
+
+#include <cmath>
+#include <limits>
+#include <utility>
+
+namespace {
+
+const std::size_t NONE = std::numeric_limits<std::size_t>::max();
+
+// scale factor that maps the extent of the values onto the 20 unit plot box
+double plotScale(const std::vector<double> &values) {
+  double min = std::numeric_limits<double>::infinity();
+  double max = -min;
+  for (auto value:values) {
+    min = value < min ? value : min;
+    max = value > max ? value : max;
+  }
+  double extent = max - min;
+  return (std::isfinite(extent) && extent > 0) ? 20 / extent : 1;
+}
+
+// remove the values whose flag is false, preserving order
+void compact(std::vector<double> &values, const std::vector<bool> &keep) {
+  std::size_t kept = 0;
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    if (keep[i])
+      values[kept++] = values[i];
+  }
+  values.resize(kept);
+}
+
+// distance from p to the segment from a to b
+double segmentDistance(double px, double py, double ax, double ay, double bx, double by) {
+  double dx = bx - ax, dy = by - ay;
+  double length = dx * dx + dy * dy;
+  double t = length > 0 ? ((px - ax) * dx + (py - ay) * dy) / length : 0;
+  t = t < 0 ? 0 : (t > 1 ? 1 : t);
+  return std::hypot(px - (ax + t * dx), py - (ay + t * dy));
+}
+
+// keep the lowest and highest point of every pixel column
+std::size_t bucket(std::vector<double> &x, std::vector<double> &y, std::size_t resolution) {
+
+  double xMin = std::numeric_limits<double>::infinity();
+  double xMax = -xMin;
+  for (auto value:x) {
+    if (std::isfinite(value)) {
+      xMin = value < xMin ? value : xMin;
+      xMax = value > xMax ? value : xMax;
+    }
+  }
+  double width = xMax > xMin ? (xMax - xMin) : 1;
+
+  std::vector<std::size_t> low(resolution, NONE);
+  std::vector<std::size_t> high(resolution, NONE);
+  for (std::size_t i = 0; i < x.size(); ++i) {
+    if (!std::isfinite(x[i]) || !std::isfinite(y[i]))
+      continue;
+    auto column = static_cast<std::size_t>((x[i] - xMin) / width * resolution);
+    column = column < resolution ? column : resolution - 1;
+    if (low[column] == NONE || y[i] < y[low[column]])
+      low[column] = i;
+    if (high[column] == NONE || y[i] > y[high[column]])
+      high[column] = i;
+  }
+
+  std::vector<bool> keep(x.size(), false);
+  std::size_t columns = 0;
+  for (std::size_t c = 0; c < resolution; ++c) {
+    if (low[c] != NONE) {
+      keep[low[c]] = true;
+      keep[high[c]] = true;
+      columns++;
+    }
+  }
+  compact(x, keep);
+  compact(y, keep);
+
+  return columns;
+}
+
+// Ramer-Douglas-Peucker simplification, returns the largest distance dropped
+double simplify(std::vector<double> &x, std::vector<double> &y, double tolerance) {
+
+  double xScale = plotScale(x);
+  double yScale = plotScale(y);
+  double maxError = 0;
+
+  std::vector<bool> keep(x.size(), false);
+  keep.front() = true;
+  keep.back() = true;
+
+  // an explicit stack keeps the depth independent of the number of points
+  std::vector<std::pair<std::size_t, std::size_t>> ranges;
+  ranges.emplace_back(0, x.size() - 1);
+  while (!ranges.empty()) {
+    std::size_t first = ranges.back().first;
+    std::size_t last = ranges.back().second;
+    ranges.pop_back();
+
+    std::size_t farthest = first;
+    double distance = 0;
+    for (std::size_t i = first + 1; i < last; ++i) {
+      double d = segmentDistance(x[i] * xScale, y[i] * yScale,
+                                 x[first] * xScale, y[first] * yScale,
+                                 x[last] * xScale, y[last] * yScale);
+      if (d > distance) {
+        distance = d;
+        farthest = i;
+      }
+    }
+
+    if (distance > tolerance) {
+      keep[farthest] = true;
+      ranges.emplace_back(first, farthest);
+      ranges.emplace_back(farthest, last);
+    } else if (distance > maxError) {
+      maxError = distance;
+    }
+  }
+
+  compact(x, keep);
+  compact(y, keep);
+
+  return maxError;
+}
+
+}
+
+DecimationStats decimate(std::vector<double> &x, std::vector<double> &y, const DecimationOptions &options) {
+
+  DecimationStats stats;
+  stats.input = x.size();
+
+  if (options.resolution > 0 && x.size() > 2 * options.resolution)
+    stats.columns = bucket(x, y, options.resolution);
+
+  if (options.tolerance > 0 && x.size() > 2)
+    stats.maxError = simplify(x, y, options.tolerance);
+
+  stats.output = x.size();
+
+  return stats;
+}
+
+DecimationStats decimateSeries(const Sequence &values, const DecimationOptions &options,
+                               std::vector<double> &x, std::vector<double> &y) {
+
+  DecimationStats stats;
+  stats.input = values.size();
+  x.clear();
+  y.clear();
+
+  if (options.resolution == 0 || values.size() <= 2 * options.resolution) {
+    x.reserve(values.size());
+    y.reserve(values.size());
+    for (std::size_t i = 0; i < values.size(); ++i) {
+      x.push_back(i);
+      y.push_back(values.at(i));
+    }
+  } else {
+    // columns are consecutive runs of indices, so each is finished before the next starts
+    std::size_t count = values.size();
+    std::size_t last = count - 1;
+    auto flush = [&](std::size_t low, std::size_t high, double lowValue, double highValue) {
+      if (low == NONE)
+        return;
+      stats.columns++;
+      std::size_t first = low < high ? low : high;
+      std::size_t second = low < high ? high : low;
+      x.push_back(first);
+      y.push_back(first == low ? lowValue : highValue);
+      if (second != first) {
+        x.push_back(second);
+        y.push_back(second == low ? lowValue : highValue);
+      }
+    };
+
+    x.reserve(2 * options.resolution + 2);
+    y.reserve(2 * options.resolution + 2);
+    x.push_back(0);
+    y.push_back(values.at(0));
+
+    std::size_t column = 0;
+    std::size_t low = NONE, high = NONE;
+    double lowValue = 0, highValue = 0;
+    for (std::size_t i = 1; i < last; ++i) {
+      std::size_t c = i * options.resolution / count;
+      if (c != column) {
+        flush(low, high, lowValue, highValue);
+        column = c;
+        low = high = NONE;
+      }
+      double value = values.at(i);
+      if (!std::isfinite(value))
+        continue;
+      if (low == NONE || value < lowValue) {
+        low = i;
+        lowValue = value;
+      }
+      if (high == NONE || value > highValue) {
+        high = i;
+        highValue = value;
+      }
+    }
+    flush(low, high, lowValue, highValue);
+
+    x.push_back(last);
+    y.push_back(values.at(last));
+  }
+
+  if (options.tolerance > 0 && x.size() > 2)
+    stats.maxError = simplify(x, y, options.tolerance);
+
+  stats.output = x.size();
+
+  return stats;
+}
@@ -0,0 +1,71 @@
+/*! \file decimate.hpp
+Defines the level-of-detail reduction applied to large plots.
+ */
+#ifndef DECIMATE_HPP
+#define DECIMATE_HPP
+
+#include <cstddef>
+#include <vector>
+
+#include "sequence.hpp"
+
+/*! \struct DecimationOptions
+\brief Parameters controlling how far a set of points is reduced.
+ */
+struct DecimationOptions {
+  /// number of pixel columns the plot is drawn into, 0 disables bucketing
+  std::size_t resolution = 1000;
+
+  /// Ramer-Douglas-Peucker tolerance in plot units, 0 disables simplification
+  double tolerance = 0;
+};
+
+/*! \struct DecimationStats
+\brief Describes what a call to decimate did, to verify its fidelity.
+ */
+struct DecimationStats {
+  /// number of points given
+  std::size_t input = 0;
+
+  /// number of points kept
+  std::size_t output = 0;
+
+  /// number of pixel columns holding at least one point
+  std::size_t columns = 0;
+
+  /// largest distance in plot units from a dropped point to the kept points
+  double maxError = 0;
+};
+
+/*! Reduce a set of points to what can be seen at a given resolution.
+
+  When there are more than two points per pixel column the points are bucketed
+  by column and only the lowest and highest point of each column are kept, so
+  the visible envelope and every extremum survive. The remaining points may
+  then be simplified with the Ramer-Douglas-Peucker algorithm, treating them
+  as a polyline in their original order. Kept points stay in that order.
+
+  \param x the abscissas, replaced by those of the kept points
+  \param y the ordinates, replaced by those of the kept points
+  \param options the resolution and tolerance to reduce to
+  \return statistics describing the reduction
+ */
+DecimationStats decimate(std::vector<double> &x, std::vector<double> &y, const DecimationOptions &options);
+
+/*! Reduce a series plotted against its index without reading it into memory.
+
+  The series is read once, in order, and only the points that decimate would
+  keep are stored, so a series backed by a mapped file costs page faults
+  rather than a copy. The first and last points are always kept so the extent
+  of the plot is unchanged.
+
+  \param values the ordinates, the abscissa of each being its index
+  \param options the resolution and tolerance to reduce to
+  \param x receives the abscissas of the kept points
+  \param y receives the ordinates of the kept points
+  \return statistics describing the reduction
+ */
+DecimationStats decimateSeries(const Sequence &values, const DecimationOptions &options,
+                               std::vector<double> &x, std::vector<double> &y);
+
+#endif
@@ -0,0 +1,94 @@
+#include "catch.hpp"
+
+#include "decimate.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+TEST_CASE("Test decimate leaves small inputs alone", "[decimate]") {
+
+  std::vector<double> x = {0, 1, 2, 3};
+  std::vector<double> y = {1, 3, 2, 4};
+
+  DecimationStats stats = decimate(x, y, DecimationOptions());
+
+  REQUIRE(stats.input == 4);
+  REQUIRE(stats.output == 4);
+  REQUIRE(stats.columns == 0);
+  REQUIRE(x == std::vector<double>({0, 1, 2, 3}));
+  REQUIRE(y == std::vector<double>({1, 3, 2, 4}));
+}
+
+TEST_CASE("Test decimate buckets by column and keeps extrema", "[decimate]") {
+
+  std::vector<double> x, y;
+  for (std::size_t i = 0; i < 100000; ++i) {
+    x.push_back(i);
+    y.push_back(std::sin(i * 0.001) + ((i % 7) == 0 ? 0.5 : 0));
+  }
+  double yMax = *std::max_element(y.cbegin(), y.cend());
+  double yMin = *std::min_element(y.cbegin(), y.cend());
+
+  DecimationOptions options;
+  options.resolution = 200;
+  DecimationStats stats = decimate(x, y, options);
+
+  REQUIRE(stats.input == 100000);
+  REQUIRE(stats.columns == 200);
+  REQUIRE(stats.output <= 400);
+  REQUIRE(stats.output == x.size());
+  REQUIRE(y.size() == x.size());
+  REQUIRE(std::is_sorted(x.cbegin(), x.cend()));
+  REQUIRE(*std::max_element(y.cbegin(), y.cend()) == yMax);
+  REQUIRE(*std::min_element(y.cbegin(), y.cend()) == yMin);
+}
+
+TEST_CASE("Test decimate simplifies with Ramer-Douglas-Peucker", "[decimate]") {
+
+  std::vector<double> x, y;
+  for (std::size_t i = 0; i <= 100; ++i) {
+    x.push_back(i);
+    y.push_back(i < 50 ? i : 100 - i);
+  }
+
+  DecimationOptions options;
+  options.resolution = 0;
+  options.tolerance = 0.01;
+  DecimationStats stats = decimate(x, y, options);
+
+  REQUIRE(stats.output == 3);
+  REQUIRE(stats.maxError <= 0.01);
+  REQUIRE(x == std::vector<double>({0, 50, 100}));
+  REQUIRE(y == std::vector<double>({0, 50, 0}));
+}
+
+TEST_CASE("Test decimateSeries matches decimate on a series", "[decimate]") {
+
+  std::vector<double> values;
+  for (std::size_t i = 0; i < 100000; ++i)
+    values.push_back(std::sin(i * 0.001) + ((i % 7) == 0 ? 0.5 : 0));
+  double yMax = *std::max_element(values.cbegin(), values.cend());
+  double yMin = *std::min_element(values.cbegin(), values.cend());
+  PackedSequence series{std::vector<double>(values)};
+
+  DecimationOptions options;
+  options.resolution = 200;
+  std::vector<double> x, y;
+  DecimationStats stats = decimateSeries(series, options, x, y);
+
+  REQUIRE(stats.input == 100000);
+  REQUIRE(stats.output <= 402);
+  REQUIRE(stats.output == x.size());
+  REQUIRE(y.size() == x.size());
+  REQUIRE(std::is_sorted(x.cbegin(), x.cend()));
+  REQUIRE(x.front() == 0);
+  REQUIRE(x.back() == 99999);
+  REQUIRE(*std::max_element(y.cbegin(), y.cend()) == yMax);
+  REQUIRE(*std::min_element(y.cbegin(), y.cend()) == yMin);
+
+  PackedSequence small(std::vector<double>({3, 1, 2}));
+  stats = decimateSeries(small, options, x, y);
+  REQUIRE(stats.output == 3);
+  REQUIRE(x == std::vector<double>({0, 1, 2}));
+  REQUIRE(y == std::vector<double>({3, 1, 2}));
+}
@@ -1,9 +1,14 @@
 #include "environment.hpp"
 
 #include <cassert>
+#include <cmath>
 #include <complex>
+#include <cstdint>
+#include <cstring>
 #include <iomanip>
 
+#include "data_file.hpp"
+#include "decimate.hpp"
 #include "environment.hpp"
 #include "semantic_error.hpp"
 
@@ -22,12 +27,12 @@ typedef'd Procedure function pointer.
 **********************************************************************/
 
 // the default procedure always returns an expresison of type None
-Expression default_proc(const std::vector<Expression> &args) {
+Expression default_proc(std::vector<Expression> &args) {
   args.size(); // make compiler happy we used this parameter
   return Expression();
 };
 
-Expression add(const std::vector<Expression> &args) {
+Expression add(std::vector<Expression> &args) {
 
   // check all arguments are numbers, while adding
   std::complex<double> result(0, 0);
@@ -45,7 +50,7 @@ Expression add(const std::vector<Expression> &args) {
   return complex ? Expression(Atom(result)) : Expression(Atom(result.real()));
 };
 
-Expression mul(const std::vector<Expression> &args) {
+Expression mul(std::vector<Expression> &args) {
 
   // check all aruments are numbers, while multiplying
   std::complex<double> result(1, 0);
@@ -64,7 +69,7 @@ Expression mul(const std::vector<Expression> &args) {
   return complex ? Expression(Atom(result)) : Expression(Atom(result.real()));
 };
 
-Expression subneg(const std::vector<Expression> &args) {
+Expression subneg(std::vector<Expression> &args) {
 
   std::complex<double> result;
   bool complex = false;
@@ -90,7 +95,7 @@ Expression subneg(const std::vector<Expression> &args) {
   return complex ? Expression(Atom(result)) : Expression(Atom(result.real()));
 };
 
-Expression div(const std::vector<Expression> &args) {
+Expression div(std::vector<Expression> &args) {
 
   std::complex<double> result;
   bool complex = false;
@@ -111,7 +116,7 @@ Expression div(const std::vector<Expression> &args) {
   return complex ? Expression(Atom(result)) : Expression(Atom(result.real()));
 };
 
-Expression sqrt(const std::vector<Expression> &args) {
+Expression sqrt(std::vector<Expression> &args) {
 
   // check if one argument
   if (args.size() != 1)
@@ -123,7 +128,7 @@ Expression sqrt(const std::vector<Expression> &args) {
     throw SemanticError("Error in call to sqrt, argument not a number");
 };
 
-Expression pow(const std::vector<Expression> &args) {
+Expression pow(std::vector<Expression> &args) {
 
   // Check if 2 args
   if (args.size() != 2)
@@ -136,7 +141,7 @@ Expression pow(const std::vector<Expression> &args) {
     throw SemanticError("Error in call to exponent, argument not a number");
 };
 
-Expression ln(const std::vector<Expression> &args) {
+Expression ln(std::vector<Expression> &args) {
   // Check if 1 args
   if (args.size() != 1)
     throw SemanticError("Error: invalid number of arguments for natural log");
@@ -147,7 +152,7 @@ Expression ln(const std::vector<Expression> &args) {
     throw SemanticError("Error in call to natural log, argument not a number");
 };
 
-Expression sin(const std::vector<Expression> &args) {
+Expression sin(std::vector<Expression> &args) {
   // Check if 1 args
   if (args.size() != 1)
     throw SemanticError("Error: invalid number of arguments for sin");
@@ -158,7 +163,7 @@ Expression sin(const std::vector<Expression> &args) {
     throw SemanticError("Error in call to sin, argument not a number");
 };
 
-Expression cos(const std::vector<Expression> &args) {
+Expression cos(std::vector<Expression> &args) {
   // Check if 1 args
   if (args.size() != 1)
     throw SemanticError("Error: invalid number of arguments for cos");
@@ -169,7 +174,7 @@ Expression cos(const std::vector<Expression> &args) {
     throw SemanticError("Error in call to cos, argument not a number");
 };
 
-Expression tan(const std::vector<Expression> &args) {
+Expression tan(std::vector<Expression> &args) {
   // Check if 1 args
   if (args.size() != 1)
     throw SemanticError("Error: invalid number of arguments for tan");
@@ -180,7 +185,7 @@ Expression tan(const std::vector<Expression> &args) {
     throw SemanticError("Error in call to tan, argument not a number");
 };
 
-Expression real(const std::vector<Expression> &args) {
+Expression real(std::vector<Expression> &args) {
   if (nargs_equal(args, 1)) {
     if (args.cbegin()->isHeadComplex()) {
       return Expression(Atom(args.cbegin()->head().getComplex().real()));
@@ -192,7 +197,7 @@ Expression real(const std::vector<Expression> &args) {
   }
 };
 
-Expression imag(const std::vector<Expression> &args) {
+Expression imag(std::vector<Expression> &args) {
   if (nargs_equal(args, 1)) {
     if (args.cbegin()->isHeadComplex()) {
       return Expression(Atom(args.cbegin()->head().getComplex().imag()));
@@ -204,7 +209,7 @@ Expression imag(const std::vector<Expression> &args) {
   }
 };
 
-Expression mag(const std::vector<Expression> &args) {
+Expression mag(std::vector<Expression> &args) {
   if (nargs_equal(args, 1)) {
     if (args.cbegin()->isHeadComplex()) {
       return Expression(Atom(std::abs(args.cbegin()->head().getComplex())));
@@ -216,7 +221,7 @@ Expression mag(const std::vector<Expression> &args) {
   }
 };
 
-Expression arg(const std::vector<Expression> &args) {
+Expression arg(std::vector<Expression> &args) {
   if (nargs_equal(args, 1)) {
     if (args.cbegin()->isHeadComplex()) {
       return Expression(Atom(std::arg(args.cbegin()->head().getComplex())));
@@ -228,7 +233,7 @@ Expression arg(const std::vector<Expression> &args) {
   }
 };
 
-Expression conj(const std::vector<Expression> &args) {
+Expression conj(std::vector<Expression> &args) {
   if (nargs_equal(args, 1)) {
     if (args.cbegin()->isHeadComplex()) {
       return Expression(Atom(std::conj(args.cbegin()->head().getComplex())));
@@ -240,12 +245,14 @@ Expression conj(const std::vector<Expression> &args) {
   }
 };
 
-Expression first(const std::vector<Expression> &args) {
+Expression first(std::vector<Expression> &args) {
   if (nargs_equal(args, 1)) {
     if (args.cbegin()->head().isSymbol() && args.cbegin()->head().asSymbol().empty()) {
       throw SemanticError("Error: argument to first is an empty list");
     } else if (args.cbegin()->isHeadNumCom()) {
       throw SemanticError("Error: argument to first is not a list");
+    } else if (args.cbegin()->getSequence() != nullptr) {
+      return Expression(args.cbegin()->getSequence()->at(0));
     } else {
       return *args.cbegin()->getTail().cbegin();
     }
@@ -254,60 +261,94 @@ Expression first(const std::vector<Expression> &args) {
   }
 };
 
-Expression rest(const std::vector<Expression> &args) {
+Expression rest(std::vector<Expression> &args) {
   if (nargs_equal(args, 1)) {
-    if (args.cbegin()->head().isSymbol() && args.cbegin()->head().asSymbol().empty()) {
-      throw SemanticError("Error: argument to first is an empty list");
-    } else if (args.cbegin()->isHeadNumCom()) {
-      throw SemanticError("Error: argument to first is not a list");
+    if (!args.cbegin()->isList()) {
+      throw SemanticError("Error: argument to rest is not a list");
+    } else if (args.cbegin()->tailSize() == 0) {
+      throw SemanticError("Error: argument to rest is an empty list");
     } else {
-      Expression exp;
-      for (auto e:args.cbegin()->getTail())
-        if (e != *args.cbegin()->getTail().cbegin())
-          exp.getTail().emplace_back(e);
-      return exp;
+      return args.cbegin()->slice(1, args.cbegin()->tailSize() - 1);
     }
   } else {
     throw SemanticError("Error: more than one argument in call to rest");
   }
 };
 
-Expression length(const std::vector<Expression> &args) {
+Expression nth(std::vector<Expression> &args) {
+  if (nargs_equal(args, 2)) {
+    if (!args.cbegin()->isList())
+      throw SemanticError("Error: first argument to nth is not a list");
+    const Expression &index = *(args.cbegin() + 1);
+    if (!index.isHeadNumber() || index.head().asNumber() < 0
+        || index.head().asNumber() != std::floor(index.head().asNumber()))
+      throw SemanticError("Error: second argument to nth is not an index");
+    if (index.head().asNumber() >= args.cbegin()->tailSize())
+      throw SemanticError("Error: index out of range in call to nth");
+    auto i = static_cast<std::size_t>(index.head().asNumber());
+    if (args.cbegin()->getSequence() != nullptr)
+      return Expression(args.cbegin()->getSequence()->at(i));
+    return args.cbegin()->getTail()[i];
+  } else {
+    throw SemanticError("Error: invalid number of arguments in call to nth");
+  }
+};
+
+Expression slice(std::vector<Expression> &args) {
+  if (nargs_equal(args, 3)) {
+    if (!args.cbegin()->isList())
+      throw SemanticError("Error: first argument to slice is not a list");
+    for (auto it = args.cbegin() + 1; it != args.cend(); ++it)
+      if (!it->isHeadNumber() || it->head().asNumber() < 0 || it->head().asNumber() != std::floor(it->head().asNumber()))
+        throw SemanticError("Error: bounds to slice are not indices");
+    double start = (args.cbegin() + 1)->head().asNumber();
+    double end = (args.cbegin() + 2)->head().asNumber();
+    if (start > end || end > args.cbegin()->tailSize())
+      throw SemanticError("Error: bounds out of range in call to slice");
+    return args.cbegin()->slice(static_cast<std::size_t>(start), static_cast<std::size_t>(end - start));
+  } else {
+    throw SemanticError("Error: invalid number of arguments in call to slice");
+  }
+};
+
+Expression length(std::vector<Expression> &args) {
   if (nargs_equal(args, 1)) {
     if (args.cbegin()->isHeadNumCom()) {
       throw SemanticError("Error: argument to first is not a list");
     } else {
-      return Expression(args.cbegin()->getTail().size());
+      return Expression(args.cbegin()->tailSize());
     }
   } else {
     throw SemanticError("Error: more than one argument in call to length");
   }
 };
 
-Expression append(const std::vector<Expression> &args) {
+Expression append(std::vector<Expression> &args) {
   if (!args.cbegin()->isList()) {
     throw SemanticError("Error: First argument not list in append");
   } else {
-    Expression value = *args.cbegin();
-    for (auto it = args.cbegin() + 1; it != args.cend(); ++it)
-      value.getTail().push_back(*it);
+    /// The list is a temporary of the call, so its nodes are changed in
+    /// place when nothing else shares them, and otherwise only the path to
+    /// its last leaf is copied
+    Expression value = std::move(*args.begin());
+    for (auto it = args.begin() + 1; it != args.end(); ++it)
+      value.getTail().push_back(std::move(*it));
     return value;
   }
 };
 
-Expression join(const std::vector<Expression> &args) {
-  Expression result = *args.cbegin();
+Expression join(std::vector<Expression> &args) {
+  /// The lists share their nodes with the result, only the seam is rebuilt
+  Expression result = std::move(*args.begin());
   for (auto arg = args.cbegin() + 1; arg != args.cend(); ++arg) {
     if (!arg->isList())
       throw SemanticError("Error: Argument to join is not a list");
-    for (auto value:arg->getTail()) {
-      result.getTail().emplace_back(value);
-    }
+    result.getTail().join(arg->getTail());
   }
   return result;
 };
 
-Expression range(const std::vector<Expression> &args) {
+Expression range(std::vector<Expression> &args) {
   if (nargs_equal(args, 3)) {
     for (auto &arg:args)
       if (!arg.isHeadNumber())
@@ -316,20 +357,22 @@ Expression range(const std::vector<Expression> &args) {
       throw SemanticError("Error: First argument is smaller than second in range");
     if ((args.cend() - 1)->head().asNumber() <= 0)
       throw SemanticError("Error: negative or zero increment in range");
-    Expression result;
-    for (double i = args.cbegin()->head().asNumber(); i <= (args.cbegin() + 1)->head().asNumber();
-         i = i + (args.cbegin() + 2)->head().asNumber()) // NOLINT(cert-flp30-c)
-      result.getTail().emplace_back(Expression(i));
-    return result;
+    /// The numbers are computed when read rather than stored
+    return Expression(std::shared_ptr<const Sequence>(
+        std::make_shared<RangeSequence>(args.cbegin()->head().asNumber(),
+                                        (args.cbegin() + 1)->head().asNumber(),
+                                        (args.cbegin() + 2)->head().asNumber())));
   } else {
     throw SemanticError("Error: Invalid number of arguments in Range");
   }
 };
 
-Expression setProperty(const std::vector<Expression> &args) {
+Expression setProperty(std::vector<Expression> &args) {
   if (nargs_equal(args, 3)) {
     if (args.cbegin()->head().isString()) {
-      Expression result = *(args.cend() - 1);
+      /// The target is a temporary of the call, so its properties are
+      /// changed in place rather than copied
+      Expression result = std::move(*(args.end() - 1));
       result.addProperty(args.cbegin()->head().asString(), *(args.cbegin() + 1));
       return result;
     } else {
@@ -340,18 +383,56 @@ Expression setProperty(const std::vector<Expression> &args) {
   }
 };
 
-Expression getProperty(const std::vector<Expression> &args) {
+Expression getProperty(std::vector<Expression> &args) {
   if (nargs_equal(args, 2)) {
     if (args.cbegin()->head().isString()) {
-      Expression result(*(args.cend() - 1));
-      return result.getProperty(args.cbegin()->head().asString());
+      /// Only the property is copied, never the object holding it
+      const Expression *value = (args.cend() - 1)->findProperty(args.cbegin()->head().asString());
+      return value != nullptr ? *value : Expression();
     } else
       throw SemanticError("Error: First Argument not a string");
   } else
     throw SemanticError("Error: Invalid number of arguments in Get Properties");
 };
 
-Expression discretePlot(const std::vector<Expression> &args) {
+Expression makePoint(std::vector<Expression> &args) {
+  if (!nargs_equal(args, 2))
+    throw SemanticError("Error: Invalid number of arguments to make-point");
+
+  if (args.cbegin()->isHeadNumber() && (args.cbegin() + 1)->isHeadNumber())
+    return Expression(args.cbegin()->head().asNumber(), (args.cbegin() + 1)->head().asNumber(), 0);
+
+  Expression result;
+  result.getTail().emplace_back(std::move(*args.begin()));
+  result.getTail().emplace_back(std::move(*(args.begin() + 1)));
+  result.addProperty("size", Expression(0.));
+  result.addProperty("object-name", Expression("point", true));
+  return result;
+};
+
+Expression makeLine(std::vector<Expression> &args) {
+  if (!nargs_equal(args, 2))
+    throw SemanticError("Error: Invalid number of arguments to make-line");
+
+  Expression result;
+  result.getTail().emplace_back(std::move(*args.begin()));
+  result.getTail().emplace_back(std::move(*(args.begin() + 1)));
+  result.addProperty("thickness", Expression(1.));
+  result.addProperty("object-name", Expression("line", true));
+  return result;
+};
+
+Expression makeText(std::vector<Expression> &args) {
+  if (!nargs_equal(args, 1))
+    throw SemanticError("Error: Invalid number of arguments to make-text");
+
+  Expression result = std::move(*args.begin());
+  result.addProperty("position", Expression(0., 0., 0.));
+  result.addProperty("object-name", Expression("text", true));
+  return result;
+};
+
+Expression discretePlot(std::vector<Expression> &args) {
 
   if (args.size() < 1)
     throw SemanticError("Error: Invalid number of parameters to discrete-plot");
@@ -359,28 +440,83 @@ Expression discretePlot(const std::vector<Expression> &args) {
   if (!args.cbegin()->isList())
     throw SemanticError("Error: Invalid type of argument to discrete-plot");
 
-  std::vector<double> xPositions;
-  std::vector<double> yPositions;
-
-  for (auto point:args.cbegin()->getTail()) {
-    if (!point.isList())
-      throw SemanticError("Error: Invalid list of plot-points to discrete-plot");
-    xPositions.emplace_back(point.getTail().cbegin()->head().asNumber());
-    yPositions.emplace_back((point.getTail().cbegin() + 1)->head().asNumber());
+  /// Get Properties
+  bool labelled = args.size() == 2 && (args.cbegin() + 1)->isList();
+  std::string title, abscLabel, ordLabel;
+  double textScale = 1;
+  DecimationOptions decimation;
+  if (labelled) {
+    for (auto &option:(args.cbegin() + 1)->getTail()) {
+      if (option.getTail().cbegin()->head().asString() == "title")
+        title = (option.getTail().cbegin() + 1)->head().asString();
+      else if (option.getTail().cbegin()->head().asString() == "abscissa-label")
+        abscLabel = (option.getTail().cbegin() + 1)->head().asString();
+      else if (option.getTail().cbegin()->head().asString() == "ordinate-label")
+        ordLabel = (option.getTail().cbegin() + 1)->head().asString();
+      else if (option.getTail().cbegin()->head().asString() == "text-scale")
+        textScale = (option.getTail().cbegin() + 1)->head().asNumber();
+      else if (option.getTail().cbegin()->head().asString() == "resolution")
+        decimation.resolution = static_cast<std::size_t>((option.getTail().cbegin() + 1)->head().asNumber());
+      else if (option.getTail().cbegin()->head().asString() == "simplify-tolerance")
+        decimation.tolerance = (option.getTail().cbegin() + 1)->head().asNumber();
+    }
   }
 
+  std::vector<double> xPositions;
+  std::vector<double> yPositions;
   double yMax, xMax, xMin, yMin;
-  double xScaleFactor = scaleFactor(xPositions, xMax, xMin);
-  double yScaleFactor = scaleFactor(yPositions, yMax, yMin);
+  double xScaleFactor, yScaleFactor;
+  DecimationStats stats;
+
+  if (args.cbegin()->tailSize() == 0)
+    throw SemanticError("Error: Invalid list of plot-points to discrete-plot");
+
+  if (args.cbegin()->getSequence() != nullptr) {
+    /// A series that is not materialized is bucketed as it is read, the
+    /// kept points include the first, last and extreme points so scaling
+    /// them gives the scale of the whole series. Simplifying can drop
+    /// extrema, so it waits until the scale is known, as for a list.
+    DecimationOptions bucketing = decimation;
+    bucketing.tolerance = 0;
+    stats = decimateSeries(*args.cbegin()->getSequence(), bucketing, xPositions, yPositions);
+    xScaleFactor = scaleFactor(xPositions, xMax, xMin);
+    yScaleFactor = scaleFactor(yPositions, yMax, yMin);
+
+    DecimationOptions simplifying = decimation;
+    simplifying.resolution = 0;
+    DecimationStats simplified = decimate(xPositions, yPositions, simplifying);
+    stats.output = simplified.output;
+    stats.maxError = simplified.maxError;
+  } else {
+    xPositions.reserve(args.cbegin()->getTail().size());
+    yPositions.reserve(args.cbegin()->getTail().size());
+
+    /// A list of numbers is a series plotted against its index
+    bool series = args.cbegin()->getTail().cbegin()->isHeadNumber();
+    for (auto &point:args.cbegin()->getTail()) {
+      if (series) {
+        if (!point.isHeadNumber())
+          throw SemanticError("Error: Invalid list of plot-points to discrete-plot");
+        xPositions.emplace_back(xPositions.size());
+        yPositions.emplace_back(point.head().asNumber());
+      } else {
+        if (!point.isList())
+          throw SemanticError("Error: Invalid list of plot-points to discrete-plot");
+        xPositions.emplace_back(point.getTail().cbegin()->head().asNumber());
+        yPositions.emplace_back((point.getTail().cbegin() + 1)->head().asNumber());
+      }
+    }
+
+    xScaleFactor = scaleFactor(xPositions, xMax, xMin);
+    yScaleFactor = scaleFactor(yPositions, yMax, yMin);
 
-  for (auto &x:xPositions) {
-    x = x * xScaleFactor;
+    /// Reduce the points to what can be seen, keeping the extrema
+    stats = decimate(xPositions, yPositions, decimation);
   }
 
   /// You must flip the y value
-  for (auto &y:yPositions) {
-    y = y * -yScaleFactor;
-  }
+  auto points = std::make_shared<Geometry>(Geometry::PointCloudKind, std::move(xPositions), std::move(yPositions));
+  points->scale(xScaleFactor, -yScaleFactor);
   yMax = -yMax;
   yMin = -yMin;
 
@@ -403,33 +539,26 @@ Expression discretePlot(const std::vector<Expression> &args) {
   if (inGraph)
     result.getTail().emplace_back(Expression(xMax, 0, xMin, 0, 0));
 
-  /// Add the points and lines
-  for (std::size_t i = 0; i < xPositions.size(); i++) {
-    result.getTail().emplace_back(Expression(*(xPositions.cbegin() + i), *(yPositions.cbegin() + i), .5));
-    if (inGraph)
-      result.getTail().emplace_back(Expression(*(xPositions.cbegin() + i), *(yPositions.cbegin() + i),
-                                               *(xPositions.cbegin() + i), 0, 0));
-    else if (aboveGraph)
-      result.getTail().emplace_back(Expression(*(xPositions.cbegin() + i), *(yPositions.cbegin() + i),
-                                               *(xPositions.cbegin() + i), yMax, 0));
-    else if (belowGraph)
-      result.getTail().emplace_back(Expression(*(xPositions.cbegin() + i), *(yPositions.cbegin() + i),
-                                               *(xPositions.cbegin() + i), yMin, 0));
+  /// Add the points and the lines joining them to the axis
+  Expression cloud(std::shared_ptr<const Geometry>(points), .5);
+  if (stats.output < stats.input) {
+    cloud.addProperty("decimation-input", Expression(static_cast<double>(stats.input)));
+    cloud.addProperty("decimation-output", Expression(static_cast<double>(stats.output)));
+    cloud.addProperty("decimation-columns", Expression(static_cast<double>(stats.columns)));
+    cloud.addProperty("decimation-error", Expression(stats.maxError));
   }
-
-  double textScale = 1;
-  if (args.size() == 2 && (args.cbegin() + 1)->isList()) {
-    std::string title, abscLabel, ordLabel;
-    for (auto &option:(args.cbegin() + 1)->getTail()) {
-      if (option.getTail().cbegin()->head().asString() == "title")
-        title = (option.getTail().cbegin() + 1)->head().asString();
-      else if (option.getTail().cbegin()->head().asString() == "abscissa-label")
-        abscLabel = (option.getTail().cbegin() + 1)->head().asString();
-      else if (option.getTail().cbegin()->head().asString() == "ordinate-label")
-        ordLabel = (option.getTail().cbegin() + 1)->head().asString();
-      else if (option.getTail().cbegin()->head().asString() == "text-scale")
-        textScale = (option.getTail().cbegin() + 1)->head().asNumber();
+  result.getTail().emplace_back(cloud);
+  if (inGraph || aboveGraph || belowGraph) {
+    double base = inGraph ? 0 : (aboveGraph ? yMax : yMin);
+    auto stems = std::make_shared<Geometry>(Geometry::SegmentsKind);
+    for (std::size_t i = 0; i < points->size(); i++) {
+      stems->add(points->x()[i], points->y()[i]);
+      stems->add(points->x()[i], base);
     }
+    result.getTail().emplace_back(Expression(std::shared_ptr<const Geometry>(stems), 0));
+  }
+
+  if (labelled) {
     /// Add Graph Labels
     result.getTail().emplace_back(Expression(title, xMax - ((xMax - xMin) / 2), (yMax - 3), textScale, 0));
     result.getTail().emplace_back(Expression(abscLabel, xMax - ((xMax - xMin) / 2), (yMin + 3), textScale, 0));
@@ -458,6 +587,72 @@ Expression discretePlot(const std::vector<Expression> &args) {
   return result;
 };
 
+Expression readCsv(std::vector<Expression> &args) {
+
+  if (args.empty() || args.size() > 3)
+    throw SemanticError("Error: Invalid number of arguments to read-csv");
+  if (!args.cbegin()->head().isString())
+    throw SemanticError("Error: First argument to read-csv not a string");
+
+  CsvOptions options;
+  if (args.size() > 1) {
+    if (!(args.cbegin() + 1)->isList())
+      throw SemanticError("Error: Second argument to read-csv not a list of columns");
+    for (auto &column:(args.cbegin() + 1)->getTail()) {
+      if (!column.isHeadNumber() || column.head().asNumber() < 0)
+        throw SemanticError("Error: Invalid column in read-csv");
+      options.columns.push_back(static_cast<std::size_t>(column.head().asNumber()));
+    }
+  }
+  if (args.size() > 2) {
+    if (!(args.cbegin() + 2)->isHeadNumber() || (args.cbegin() + 2)->head().asNumber() < 0)
+      throw SemanticError("Error: Third argument to read-csv not a row limit");
+    options.rowLimit = static_cast<std::size_t>((args.cbegin() + 2)->head().asNumber());
+  }
+
+  /// Columns are handed over packed and only become Expressions when accessed
+  Expression result;
+  for (auto &column:loadCsv(args.cbegin()->head().asString(), options))
+    result.getTail().emplace_back(std::shared_ptr<const Sequence>(std::make_shared<PackedSequence>(std::move(column))));
+  return result;
+};
+
+// the list for a loaded array, a list of column lists if it has two dimensions
+Expression arrayExpression(const ArrayData &array) {
+  if (array.shape.size() == 1)
+    return Expression(array.columns.front());
+  if (array.columns.empty())
+    return Expression(Atom(""));
+
+  Expression result;
+  for (auto &column:array.columns)
+    result.getTail().emplace_back(column);
+  return result;
+}
+
+Expression readBinary(std::vector<Expression> &args) {
+
+  if (args.empty() || args.size() > 2)
+    throw SemanticError("Error: Invalid number of arguments to read-binary");
+  if (!args.cbegin()->head().isString())
+    throw SemanticError("Error: First argument to read-binary not a string");
+  if (args.size() == 2 && !(args.cbegin() + 1)->head().isString())
+    throw SemanticError("Error: Second argument to read-binary not an element type");
+
+  std::string descr = args.size() == 2 ? (args.cbegin() + 1)->head().asString() : "<f8";
+  return arrayExpression(loadBinary(args.cbegin()->head().asString(), descr));
+};
+
+Expression readNpy(std::vector<Expression> &args) {
+
+  if (!nargs_equal(args, 1))
+    throw SemanticError("Error: Invalid number of arguments to read-npy");
+  if (!args.cbegin()->head().isString())
+    throw SemanticError("Error: Argument to read-npy not a string");
+
+  return arrayExpression(loadNpy(args.cbegin()->head().asString()));
+};
+
 const
 double PI = std::atan2(0, -1);
 const double EXP = std::exp(1);
@@ -468,19 +663,32 @@ Environment::Environment() {
   reset();
 }
 
-bool Environment::is_known(const Atom &sym) const {
+const Environment::EnvResult *Environment::find(const Atom &sym) const {
   if (!sym.isSymbol())
-    return false;
+    return nullptr;
+
+  auto result = envmap.find(sym.asSymbol());
+  if (result != envmap.end())
+    return result->second.type == RemovedType ? nullptr : &result->second;
+
+  if (base) {
+    result = base->find(sym.asSymbol());
+    if (result != base->end())
+      return &result->second;
+  }
+
+  return nullptr;
+}
 
-  return envmap.find(sym.asSymbol()) != envmap.end();
+bool Environment::is_known(const Atom &sym) const {
+
+  return find(sym) != nullptr;
 }
 
 bool Environment::is_exp(const Atom &sym) const {
-  if (!sym.isSymbol())
-    return false;
 
-  auto result = envmap.find(sym.asSymbol());
-  return (result != envmap.end()) && (result->second.type == ExpressionType);
+  auto result = find(sym);
+  return (result != nullptr) && (result->type == ExpressionType);
 }
 
 Expression Environment::get_exp(const Atom &sym) const {
@@ -488,11 +696,9 @@ Expression Environment::get_exp(const Atom &sym) const {
   Expression
       exp;
 
-  if (sym.isSymbol()) {
-    auto result = envmap.find(sym.asSymbol());
-    if ((result != envmap.end()) && (result->second.type == ExpressionType)) {
-      exp = result->second.exp;
-    }
+  auto result = find(sym);
+  if ((result != nullptr) && (result->type == ExpressionType)) {
+    exp = result->exp;
   }
 
   return exp;
@@ -504,7 +710,11 @@ void Environment::rem_exp(const Atom &sym) {
     throw SemanticError("Attempt to remove non-symbol to environment");
   }
 
-  envmap.erase(sym.asSymbol());
+  // the snapshot is shared, so hide its definition rather than erase it
+  if (base && base->find(sym.asSymbol()) != base->end())
+    envmap[sym.asSymbol()] = EnvResult(RemovedType, Expression());
+  else
+    envmap.erase(sym.asSymbol());
 }
 
 Expression Environment::get_lambda(const Atom &sym) const {
@@ -512,11 +722,9 @@ Expression Environment::get_lambda(const Atom &sym) const {
   Expression
       exp;
 
-  if (sym.isSymbol()) {
-    auto result = envmap.find(sym.asSymbol());
-    if ((result != envmap.end()) && (result->second.type == LambdaType)) {
-      exp = result->second.exp;
-    }
+  auto result = find(sym);
+  if ((result != nullptr) && (result->type == LambdaType)) {
+    exp = result->exp;
   }
 
   return exp;
@@ -529,43 +737,57 @@ void Environment::add_exp(const Atom &sym, const Expression &exp) {
   }
 
   // error if overwriting symbol map
-  if (envmap.find(sym.asSymbol()) != envmap.end()) {
+  if (find(sym) != nullptr) {
     throw SemanticError("Attempt to overwrite symbol in environemnt");
   }
 
-  envmap.emplace(sym.asSymbol(), EnvResult(exp.isLambda() ? LambdaType : ExpressionType, exp));
+  envmap[sym.asSymbol()] = EnvResult(exp.isLambda() ? LambdaType : ExpressionType, exp);
 }
 
 bool Environment::is_proc(const Atom &sym) const {
-  if (!sym.isSymbol())
-    return false;
 
-  auto result = envmap.find(sym.asSymbol());
-  return (result != envmap.end()) && (result->second.type == ProcedureType);
+  auto result = find(sym);
+  return (result != nullptr) && (result->type == ProcedureType);
 }
 
 bool Environment::is_lambda(const Atom &sym) const {
-  if (!sym.isSymbol())
-    return false;
 
-  auto result = envmap.find(sym.asSymbol());
-  return (result != envmap.end()) && (result->second.type == LambdaType);
+  auto result = find(sym);
+  return (result != nullptr) && (result->type == LambdaType);
 }
 
 Procedure Environment::get_proc(const Atom &sym) const {
 
   //Procedure proc = default_proc;
 
-  if (sym.isSymbol()) {
-    auto result = envmap.find(sym.asSymbol());
-    if ((result != envmap.end()) && (result->second.type == ProcedureType)) {
-      return result->second.proc;
-    }
+  auto result = find(sym);
+  if ((result != nullptr) && (result->type == ProcedureType)) {
+    return result->proc;
   }
 
   return default_proc;
 }
 
+void Environment::snapshot() {
+
+  auto merged = base ? std::make_shared<EnvMap>(*base) : std::make_shared<EnvMap>();
+  for (auto &entry:envmap) {
+    if (entry.second.type == RemovedType) {
+      merged->erase(entry.first);
+    } else {
+      (*merged)[entry.first] = entry.second;
+    }
+  }
+
+  envmap.clear();
+  base = merged;
+}
+
+void Environment::restore() {
+
+  envmap.clear();
+}
+
 /*
 Reset the environment to the default state. First remove all entries and
 then re-add the default ones.
@@ -573,6 +795,7 @@ then re-add the default ones.
 void Environment::reset() {
 
   envmap.clear();
+  base.reset();
 
   // Built-In value of pi
   envmap.emplace("pi", EnvResult(ExpressionType, Expression(Atom(PI))));
@@ -637,6 +860,12 @@ void Environment::reset() {
   // Procedure: rest;
   envmap.emplace("rest", EnvResult(ProcedureType, rest));
 
+  // Procedure: nth
+  envmap.emplace("nth", EnvResult(ProcedureType, nth));
+
+  // Procedure: slice
+  envmap.emplace("slice", EnvResult(ProcedureType, slice));
+
   // Procedure: length;
   envmap.emplace("length", EnvResult(ProcedureType, length));
 
@@ -655,11 +884,99 @@ void Environment::reset() {
   // Procedure: get-property
   envmap.emplace("get-property", EnvResult(ProcedureType, getProperty));
 
+  // Procedure: make-point
+  envmap.emplace("make-point", EnvResult(ProcedureType, makePoint));
+
+  // Procedure: make-line
+  envmap.emplace("make-line", EnvResult(ProcedureType, makeLine));
+
+  // Procedure: make-text
+  envmap.emplace("make-text", EnvResult(ProcedureType, makeText));
+
   // Procedure: discrete-plot
   envmap.emplace("discrete-plot", EnvResult(ProcedureType, discretePlot));
+
+  // Procedure: read-csv
+  envmap.emplace("read-csv", EnvResult(ProcedureType, readCsv));
+
+  // Procedure: read-binary
+  envmap.emplace("read-binary", EnvResult(ProcedureType, readBinary));
+
+  // Procedure: read-npy
+  envmap.emplace("read-npy", EnvResult(ProcedureType, readNpy));
+}
+
+void Environment::saveImage(std::string &image) const {
+
+  EnvMap entries = base ? *base : EnvMap();
+  for (auto &entry:envmap) {
+    if (entry.second.type == RemovedType)
+      entries.erase(entry.first);
+    else
+      entries[entry.first] = entry.second;
+  }
+
+  std::uint64_t count = 0;
+  for (auto &entry:entries)
+    count += entry.second.type != ProcedureType;
+  image.append(reinterpret_cast<const char *>(&count), sizeof(count));
+
+  for (auto &entry:entries) {
+    if (entry.second.type == ProcedureType)
+      continue;
+    Expression(Atom(entry.first)).serialize(image);
+    image.push_back(entry.second.type == LambdaType ? 1 : 0);
+    entry.second.exp.serialize(image);
+  }
+}
+
+bool Environment::loadImage(const char *first, const char *last) {
+
+  std::uint64_t count;
+  if (last - first < static_cast<std::ptrdiff_t>(sizeof(count)))
+    return false;
+  std::memcpy(&count, first, sizeof(count));
+  first += sizeof(count);
+
+  /// Decode everything before defining anything
+  std::vector<std::pair<std::string, EnvResult>> entries;
+  for (std::uint64_t i = 0; i < count; ++i) {
+    Expression name, exp;
+    if (!Expression::deserialize(first, last, name) || !name.isHeadSymbol() || first == last)
+      return false;
+    bool lambda = *first++ != 0;
+    if (!Expression::deserialize(first, last, exp))
+      return false;
+    entries.emplace_back(name.head().asSymbol(), EnvResult(lambda ? LambdaType : ExpressionType, exp));
+  }
+  if (first != last)
+    return false;
+
+  for (auto &entry:entries)
+    envmap[entry.first] = entry.second;
+  return true;
 }
 
 Environment::Environment(const Environment &env) {
 
   this->envmap = env.envmap;
+  this->base = env.base;
+  this->interrupt = env.interrupt;
+  this->budget = env.budget;
+  this->progress = env.progress;
+}
+
+void Environment::setInterrupt(const std::atomic<bool> *flag) noexcept {
+
+  interrupt = flag;
+}
+
+void Environment::setBudget(Budget *budget) noexcept {
+
+  this->budget = budget;
+}
+
+void Environment::setProgress(const Progress *progress) noexcept {
+
+  this->progress = progress;
 }
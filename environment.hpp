@@ -11,17 +11,37 @@ needed.
 #define ENVIRONMENT_HPP
 
 // system includes
+#include <atomic>
+#include <functional>
 #include <map>
+#include <memory>
 
 // module includes
 #include "atom.hpp"
+#include "budget.hpp"
 #include "expression.hpp"
+#include "semantic_error.hpp"
 
 /*! \typedef Procedure
 \brief A Procedure is a C++ function pointer taking a vector of 
        Expressions as arguments and returning an Expression.
+
+The arguments are values evaluated for the call and owned by the caller,
+so a Procedure may move from them to build its result in place.
+*/
+typedef Expression (*Procedure)(std::vector<Expression> &args);
+
+/*! \struct Progress
+\brief Receives partial results of a long evaluation, such as a plot drawn
+       before its sampling is complete, on the thread evaluating.
 */
-typedef Expression (*Procedure)(const std::vector<Expression> &args);
+struct Progress {
+  /// true if a partial result would be taken now, asked before one is built
+  std::function<bool()> wanted;
+
+  /// receives a partial result
+  std::function<void(const Expression &partial)> report;
+};
 
 /*! \class Environment
 \brief A class representing the interpreter environment.
@@ -107,10 +127,67 @@ public:
   /*! Reset the environment to its default state. */
   void reset();
 
+  /*! Make the current definitions a snapshot that restore returns to.
+    The snapshot is shared by copies of the environment and never changes.
+   */
+  void snapshot();
+
+  /*! Drop every definition made since the last snapshot, in time
+    independent of the size of the snapshot. */
+  void restore();
+
+  /*! Set the flag that interrupts evaluation in this environment and its copies.
+    \param flag the flag, owned by the caller, or nullptr for none
+   */
+  void setInterrupt(const std::atomic<bool> *flag) noexcept;
+
+  /*! Check the interrupt flag, called where evaluation loops or recurses.
+    \throws Interrupted if the flag is set
+   */
+  void checkInterrupt() const {
+    if (interrupt != nullptr && interrupt->load(std::memory_order_relaxed))
+      throw Interrupted();
+  }
+
+  /*! Set the budget that evaluation in this environment and its copies counts against.
+    \param budget the budget, owned by the caller, or nullptr for none
+   */
+  void setBudget(Budget *budget) noexcept;
+
+  /// the budget evaluation counts against, or nullptr
+  Budget *getBudget() const noexcept {
+    return budget;
+  }
+
+  /*! Set the functions that receive the partial results of evaluation in
+    this environment and its copies.
+    \param progress the functions, owned by the caller, or nullptr for none
+   */
+  void setProgress(const Progress *progress) noexcept;
+
+  /// the functions receiving partial results, or nullptr
+  const Progress *getProgress() const noexcept {
+    return progress;
+  }
+
+  /*! Append the expressions and lambdas defined in the environment to an image.
+    Procedures are not written, reset provides them.
+    \param image the bytes to append to
+   */
+  void saveImage(std::string &image) const;
+
+  /*! Define the expressions and lambdas of an image written by saveImage.
+    \param first the first byte of the image
+    \param last one past the last byte of the image
+    \return false if the image is not valid, in which case the environment is unchanged
+   */
+  bool loadImage(const char *first, const char *last);
+
 private:
 
   // Environment is a mapping from symbols to expressions or procedures
-  enum EnvResultType { ExpressionType, ProcedureType, LambdaType };
+  // RemovedType hides a definition of the snapshot
+  enum EnvResultType { ExpressionType, ProcedureType, LambdaType, RemovedType };
 
   struct EnvResult {
     EnvResultType type;
@@ -123,8 +200,25 @@ private:
     EnvResult(EnvResultType t, Procedure p) : type(t), proc(p) {};
   };
 
-  // the environment map
-  std::map<std::string, EnvResult> envmap;
+  typedef std::map<std::string, EnvResult> EnvMap;
+
+  // the definitions made since the snapshot, looked up first
+  EnvMap envmap;
+
+  // the definitions of the last snapshot, shared by copies
+  std::shared_ptr<const EnvMap> base;
+
+  // set to interrupt evaluation, shared by copies
+  const std::atomic<bool> *interrupt = nullptr;
+
+  // counts the resources evaluation uses, shared by copies
+  Budget *budget = nullptr;
+
+  // receives partial results, shared by copies
+  const Progress *progress = nullptr;
+
+  // the definition of sym, or nullptr if there is none
+  const EnvResult *find(const Atom &sym) const;
 };
 
 #endif
@@ -82,6 +82,32 @@ TEST_CASE("Test reset", "[environment]") {
   REQUIRE(env.get_exp(Atom("hi")) == Expression());
 }
 
+TEST_CASE("Test restoring a snapshot", "[environment]") {
+  Environment env;
+
+  env.add_exp(Atom("one"), Expression(Atom(1.0)));
+  env.snapshot();
+  env.add_exp(Atom("two"), Expression(Atom(2.0)));
+  REQUIRE_THROWS_AS(env.add_exp(Atom("one"), Expression(Atom(3.0))), SemanticError);
+
+  /// copies share the snapshot and keep their own definitions
+  Environment copy(env);
+  copy.rem_exp(Atom("one"));
+  REQUIRE(!copy.is_known(Atom("one")));
+  copy.add_exp(Atom("one"), Expression(Atom(3.0)));
+  REQUIRE(copy.get_exp(Atom("one")) == Expression(Atom(3.0)));
+  REQUIRE(env.get_exp(Atom("one")) == Expression(Atom(1.0)));
+
+  env.restore();
+  REQUIRE(env.get_exp(Atom("one")) == Expression(Atom(1.0)));
+  REQUIRE(!env.is_known(Atom("two")));
+  REQUIRE(env.is_proc(Atom("+")));
+
+  env.reset();
+  REQUIRE(!env.is_known(Atom("one")));
+  REQUIRE(env.is_proc(Atom("+")));
+}
+
 TEST_CASE("Test semeantic errors", "[environment]") {
 
   Environment env;
@@ -1,11 +1,21 @@
 #include "expression.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <sstream>
 #include <list>
+#include <mutex>
 #include <string>
 #include <iomanip>
+#include <iterator>
+#include <limits>
 
 #include "environment.hpp"
+#include "sampler.hpp"
 #include "semantic_error.hpp"
 
 Expression::Expression(const Atom &a) {
@@ -13,15 +23,15 @@ Expression::Expression(const Atom &a) {
   m_head = a;
 }
 
-// recursive copy
+// copies share the tail until one of them changes it
 Expression::Expression(const Expression &a) {
 
   m_head = a.m_head;
-  for (auto e : a.m_tail) {
-    m_tail.emplace_back(e);
-  }
+  m_tail = a.m_tail;
   m_Lambda = a.m_Lambda;
   m_properties = a.m_properties;
+  m_geometry = a.m_geometry;
+  m_lazy = a.m_lazy;
 }
 
 Expression::Expression(const double &value) {
@@ -45,17 +55,391 @@ Expression &Expression::operator=(const Expression &a) {
   // prevent self-assignment
   if (this != &a) {
     m_head = a.m_head;
-    m_tail.clear();
-    for (auto e : a.m_tail) {
-      m_tail.emplace_back(e);
-    }
+    m_tail = a.m_tail;
   }
   m_Lambda = a.m_Lambda;
   m_properties = a.m_properties;
+  m_geometry = a.m_geometry;
+  m_lazy = a.m_lazy;
+
+  return *this;
+}
+
+// const readers of a lazy list may be on several threads, so its tail is
+// built once under the once flag and never changed afterwards
+struct Expression::Lazy {
+
+  explicit Lazy(const std::shared_ptr<const Sequence> &numbers) : sequence(numbers) {}
+
+  const Tail &tail() {
+    std::call_once(once, [this]() {
+      std::vector<Expression> items;
+      items.reserve(sequence->size());
+      for (std::size_t i = 0; i < sequence->size(); ++i)
+        items.emplace_back(sequence->at(i));
+      built = Tail(std::move(items));
+    });
+    return built;
+  }
+
+  std::shared_ptr<const Sequence> sequence;
+  std::once_flag once;
+  Tail built;
+};
+
+// a node of the tree behind a Tail, only ever changed through a Tail that
+// no other Tail shares it with
+struct Tail::Node {
+  // the number of expressions below the node
+  std::size_t size = 0;
+
+  // 0 for a leaf, otherwise one more than the taller child
+  int height = 0;
+
+  // the children of an inner node, neither is null
+  std::shared_ptr<Node> left;
+  std::shared_ptr<Node> right;
+
+  // the expressions of a leaf
+  std::vector<Expression> items;
+};
+
+// The tree is an AVL tree of leaves, so its height is O(log n) and two trees
+// are joined by descending the spine of the taller one to the height of the
+// other, rotating at most once per level on the way back up. A node is
+// copied before it is changed unless it is reached from the root through
+// nodes that no other tree shares.
+struct Tail::Tree {
+
+  typedef std::shared_ptr<Node> Pointer;
+
+  // the most expressions a leaf holds
+  static const std::size_t LEAF_CAPACITY = 32;
+
+  static int height(const Pointer &node) noexcept {
+    return node == nullptr ? -1 : node->height;
+  }
+
+  static bool unique(const Pointer &node) noexcept {
+    if (node.use_count() != 1)
+      return false;
+    // the count is read relaxed, so order the changes about to be made
+    // after the reads of trees released on other threads
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return true;
+  }
+
+  // make slot hold a node no other tree shares, copying it if needed
+  static void own(Pointer &slot) {
+    if (!unique(slot))
+      slot = std::make_shared<Node>(*slot);
+  }
+
+  // own every node holding an expression in [first, last)
+  static void own(Pointer &slot, std::size_t first, std::size_t last) {
+    own(slot);
+    if (slot->height == 0)
+      return;
+    std::size_t middle = slot->left->size;
+    if (first < middle)
+      own(slot->left, first, last < middle ? last : middle);
+    if (last > middle)
+      own(slot->right, first > middle ? first - middle : 0, last - middle);
+  }
+
+  static Pointer leaf(std::vector<Expression> &&items) {
+    auto node = std::make_shared<Node>();
+    node->size = items.size();
+    node->items = std::move(items);
+    return node;
+  }
+
+  static Pointer inner(const Pointer &left, const Pointer &right) {
+    auto node = std::make_shared<Node>();
+    node->size = left->size + right->size;
+    node->height = 1 + std::max(left->height, right->height);
+    node->left = left;
+    node->right = right;
+    return node;
+  }
+
+  // a node over left and right, whose heights differ by at most two
+  static Pointer balance(const Pointer &left, const Pointer &right) {
+    if (height(left) > height(right) + 1) {
+      if (height(left->left) >= height(left->right))
+        return inner(left->left, inner(left->right, right));
+      return inner(inner(left->left, left->right->left), inner(left->right->right, right));
+    }
+    if (height(right) > height(left) + 1) {
+      if (height(right->right) >= height(right->left))
+        return inner(inner(left, right->left), right->right);
+      return inner(inner(left, right->left->left), inner(right->left->right, right->right));
+    }
+    return inner(left, right);
+  }
+
+  // the expressions of left followed by those of right, either may be null
+  static Pointer join(const Pointer &left, const Pointer &right) {
+    if (left == nullptr)
+      return right;
+    if (right == nullptr)
+      return left;
+    if (left->height > right->height + 1)
+      return balance(left->left, join(left->right, right));
+    if (right->height > left->height + 1)
+      return balance(join(left, right->left), right->right);
+    if (left->height == 0 && right->height == 0 && left->size + right->size <= LEAF_CAPACITY) {
+      std::vector<Expression> items(left->items);
+      items.insert(items.end(), right->items.cbegin(), right->items.cend());
+      return leaf(std::move(items));
+    }
+    return inner(left, right);
+  }
+
+  // the expressions [first, last) of node, sharing the nodes wholly inside
+  static Pointer sub(const Pointer &node, std::size_t first, std::size_t last) {
+    if (first >= last)
+      return nullptr;
+    if (first == 0 && last == node->size)
+      return node;
+    if (node->height == 0)
+      return leaf(std::vector<Expression>(node->items.cbegin() + first, node->items.cbegin() + last));
+    std::size_t middle = node->left->size;
+    if (last <= middle)
+      return sub(node->left, first, last);
+    if (first >= middle)
+      return sub(node->right, first - middle, last - middle);
+    return join(sub(node->left, first, middle), sub(node->right, 0, last - middle));
+  }
+
+  // a tree over leaves [first, last) whose heights differ by at most one
+  static Pointer build(const std::vector<Pointer> &leaves, std::size_t first, std::size_t last) {
+    if (last - first == 1)
+      return leaves[first];
+    std::size_t middle = first + (last - first) / 2;
+    return inner(build(leaves, first, middle), build(leaves, middle, last));
+  }
 
+  // add value after the last expression of slot
+  static void push(Pointer &slot, Expression &&value) {
+    if (slot == nullptr) {
+      std::vector<Expression> items;
+      items.push_back(std::move(value));
+      slot = leaf(std::move(items));
+    } else if (slot->height == 0 && slot->size < LEAF_CAPACITY) {
+      own(slot);
+      slot->items.push_back(std::move(value));
+      slot->size++;
+    } else if (slot->height == 0) {
+      Pointer last;
+      push(last, std::move(value));
+      slot = inner(slot, last);
+    } else {
+      own(slot);
+      push(slot->right, std::move(value));
+      if (std::abs(height(slot->left) - height(slot->right)) <= 1) {
+        slot->size++;
+        slot->height = 1 + std::max(slot->left->height, slot->right->height);
+      } else {
+        slot = balance(slot->left, slot->right);
+      }
+    }
+  }
+
+  // the expression at index, owning the nodes above it
+  static Expression &at(Pointer &slot, std::size_t index) {
+    own(slot);
+    if (slot->height == 0)
+      return slot->items[index];
+    if (index < slot->left->size)
+      return at(slot->left, index);
+    return at(slot->right, index - slot->left->size);
+  }
+
+  // the leaf holding index, and the index of its first expression
+  static const Node *find(const Node *node, std::size_t index, std::size_t &start) noexcept {
+    start = 0;
+    while (node->height != 0) {
+      if (index < node->left->size) {
+        node = node->left.get();
+      } else {
+        index -= node->left->size;
+        start += node->left->size;
+        node = node->right.get();
+      }
+    }
+    return node;
+  }
+};
+
+template<typename T>
+void Tail::Iterator<T>::seek() const {
+  std::size_t start;
+  const Node *leaf = Tree::find(m_root, m_offset + m_index, start);
+  // the expressions of the leaf before the view are not in it
+  std::size_t skip = m_offset > start ? m_offset - start : 0;
+  m_items = const_cast<T *>(leaf->items.data()) + skip;
+  m_first = start + skip - m_offset;
+  m_count = leaf->size - skip;
+}
+
+template class Tail::Iterator<Expression>;
+template class Tail::Iterator<const Expression>;
+
+Tail::Tail(std::vector<Expression> &&items) {
+  if (items.empty())
+    return;
+  std::vector<Tree::Pointer> leaves;
+  for (std::size_t first = 0; first < items.size(); first += Tree::LEAF_CAPACITY) {
+    auto last = items.begin() + std::min(first + Tree::LEAF_CAPACITY, items.size());
+    leaves.push_back(Tree::leaf(std::vector<Expression>(std::make_move_iterator(items.begin() + first),
+                                                        std::make_move_iterator(last))));
+  }
+  m_root = Tree::build(leaves, 0, leaves.size());
+  m_length = items.size();
+}
+
+Tail::Tail(Tail &&other) noexcept
+    : m_root(std::move(other.m_root)), m_offset(other.m_offset), m_length(other.m_length) {
+  other.m_offset = 0;
+  other.m_length = 0;
+}
+
+Tail &Tail::operator=(Tail &&other) noexcept {
+  if (this != &other) {
+    m_root = std::move(other.m_root);
+    m_offset = other.m_offset;
+    m_length = other.m_length;
+    other.m_offset = 0;
+    other.m_length = 0;
+  }
   return *this;
 }
 
+std::size_t Tail::size() const noexcept {
+  return m_length;
+}
+
+bool Tail::empty() const noexcept {
+  return m_length == 0;
+}
+
+Tail::const_iterator Tail::begin() const noexcept {
+  return const_iterator(m_root.get(), m_offset, 0);
+}
+
+Tail::const_iterator Tail::end() const noexcept {
+  return const_iterator(m_root.get(), m_offset, m_length);
+}
+
+Tail::const_iterator Tail::cbegin() const noexcept {
+  return begin();
+}
+
+Tail::const_iterator Tail::cend() const noexcept {
+  return end();
+}
+
+Tail::iterator Tail::begin() {
+  if (m_length != 0)
+    Tree::own(m_root, m_offset, m_offset + m_length);
+  return iterator(m_root.get(), m_offset, 0);
+}
+
+Tail::iterator Tail::end() {
+  return begin() + m_length;
+}
+
+const Expression &Tail::operator[](std::size_t index) const noexcept {
+  std::size_t start;
+  const Node *leaf = Tree::find(m_root.get(), m_offset + index, start);
+  return leaf->items[m_offset + index - start];
+}
+
+Expression &Tail::operator[](std::size_t index) {
+  return Tree::at(m_root, m_offset + index);
+}
+
+const Expression &Tail::back() const noexcept {
+  return (*this)[m_length - 1];
+}
+
+Expression &Tail::back() {
+  return Tree::at(m_root, m_offset + m_length - 1);
+}
+
+void Tail::push_back(const Expression &value) {
+  emplace_back(value);
+}
+
+void Tail::pop_back() noexcept {
+  // shrinking the view is enough, the next append trims the tree
+  if (--m_length == 0)
+    clear();
+}
+
+void Tail::insert(const_iterator position, const Expression &value) {
+  std::size_t index = position - cbegin();
+  Tree::Pointer middle;
+  Tree::push(middle, Expression(value));
+  Tree::Pointer before = Tree::sub(m_root, m_offset, m_offset + index);
+  Tree::Pointer after = Tree::sub(m_root, m_offset + index, m_offset + m_length);
+  m_root = Tree::join(Tree::join(before, middle), after);
+  m_offset = 0;
+  m_length++;
+}
+
+void Tail::join(const Tail &other) {
+
+  // copy first, other may be this Tail
+  Tail right(other);
+  if (right.m_length <= Tree::LEAF_CAPACITY) {
+    for (auto &value:right)
+      emplace_back(value);
+    return;
+  }
+
+  trim();
+  right.trim();
+  m_root = Tree::join(m_root, right.m_root);
+  m_length += right.m_length;
+}
+
+void Tail::clear() noexcept {
+  m_root.reset();
+  m_offset = 0;
+  m_length = 0;
+}
+
+Tail Tail::slice(std::size_t offset, std::size_t length) const noexcept {
+  Tail result;
+  if (length > 0) {
+    result.m_root = m_root;
+    result.m_offset = m_offset + offset;
+    result.m_length = length;
+  }
+  return result;
+}
+
+void Tail::trim() {
+  if (m_length == 0) {
+    clear();
+  } else if (m_offset != 0 || m_length != m_root->size) {
+    m_root = Tree::sub(m_root, m_offset, m_offset + m_length);
+    m_offset = 0;
+  }
+}
+
+void Tail::append(Expression &&value) {
+
+  // the expressions after the view are dropped before the tree grows, the
+  // nodes on the path to the last leaf are copied if another Tail shares them
+  if (m_root != nullptr && m_offset + m_length != m_root->size)
+    trim();
+  Tree::push(m_root, std::move(value));
+  m_length++;
+}
+
 Atom &Expression::head() {
   return m_head;
 }
@@ -81,7 +465,7 @@ bool Expression::isHeadNumCom() const noexcept {
 }
 
 bool Expression::isList() const noexcept {
-  return (m_head.isSymbol() && m_head.asSymbol().empty()) || !m_tail.empty();
+  return (m_head.isSymbol() && m_head.asSymbol().empty()) || !m_tail.empty() || m_lazy != nullptr;
 }
 
 bool Expression::isLambda() const noexcept {
@@ -92,27 +476,32 @@ void Expression::addProperty(const std::string &key, const Expression &value) {
   auto exists = m_properties.find(key);
   if (exists == m_properties.end())
     m_properties.emplace(key, value);
-  else {
-    m_properties.erase(exists);
-    m_properties.emplace(key, value);
-  }
+  else
+    exists->second = value;
 }
 
-Expression Expression::getProperty(std::string key) const {
-  auto value = m_properties.find(key);
-  if (value != m_properties.end())
-    return value->second;
+Expression Expression::getProperty(const std::string &key) const {
+  const Expression *value = findProperty(key);
+  if (value != nullptr)
+    return *value;
   else
     return Expression();
 }
 
+const Expression *Expression::findProperty(const std::string &key) const noexcept {
+  auto value = m_properties.find(key);
+  return value != m_properties.end() ? &value->second : nullptr;
+}
+
 void Expression::append(const Atom &a) {
+  materialize();
   m_tail.emplace_back(a);
 }
 
 Expression *Expression::tail() {
   Expression *ptr = nullptr;
 
+  materialize();
   if (!m_tail.empty()) {
     ptr = &m_tail.back();
   }
@@ -120,24 +509,56 @@ Expression *Expression::tail() {
   return ptr;
 }
 
-const std::vector<Expression> &Expression::getTail() const {
-  return m_tail;
+const Tail &Expression::getTail() const {
+  return m_lazy != nullptr ? m_lazy->tail() : m_tail;
 }
 
-std::vector<Expression> &Expression::getTail() {
+Tail &Expression::getTail() {
+  materialize();
   return m_tail;
 }
 
-Expression::ConstIteratorType Expression::tailConstBegin() const noexcept {
-  return m_tail.cbegin();
+Expression Expression::slice(std::size_t offset, std::size_t length) const {
+
+  // an empty list is represented by its empty symbol head
+  if (length == 0)
+    return Expression(Atom(""));
+
+  Expression result;
+  if (m_lazy != nullptr)
+    result.m_lazy = std::make_shared<Lazy>(std::make_shared<SliceSequence>(m_lazy->sequence, offset, length));
+  else
+    result.m_tail = m_tail.slice(offset, length);
+  return result;
+}
+
+std::size_t Expression::tailSize() const noexcept {
+  return m_lazy != nullptr ? m_lazy->sequence->size() : m_tail.size();
+}
+
+const Sequence *Expression::getSequence() const noexcept {
+  return m_lazy != nullptr ? m_lazy->sequence.get() : nullptr;
+}
+
+void Expression::materialize() {
+  if (m_lazy != nullptr) {
+    m_tail = m_lazy->tail();
+    m_lazy.reset();
+  }
+}
+
+Expression::ConstIteratorType Expression::tailConstBegin() const {
+  return getTail().cbegin();
 }
 
-Expression::ConstIteratorType Expression::tailConstEnd() const noexcept {
-  return m_tail.cend();
+Expression::ConstIteratorType Expression::tailConstEnd() const {
+  return getTail().cend();
 }
 
 Expression lambda(const std::vector<Expression> &args, const Environment &env) {
 
+  env.checkInterrupt();
+
   Expression lambda = *(args.cend() - 1);
   Environment dummyEnv(env);
   auto it = args.cbegin();
@@ -155,7 +576,7 @@ Expression lambda(const std::vector<Expression> &args, const Environment &env) {
 
 }
 
-Expression apply(const Atom &op, const std::vector<Expression> &args, const Environment &env) {
+Expression apply(const Atom &op, std::vector<Expression> &args, const Environment &env) {
 
   // Return if it is a string
   if (op.isString())
@@ -175,14 +596,235 @@ Expression apply(const Atom &op, const std::vector<Expression> &args, const Envi
     // map from symbol to proc
     Procedure proc = env.get_proc(op);
     // call proc with args
-    return proc(args);
+    Expression result = proc(args);
+    if (env.getBudget() != nullptr && result.isList())
+      env.getBudget()->charge(result.tailSize());
+    return result;
   } else {
-    std::vector<Expression> args_Copy = args;
-    args_Copy.push_back(env.get_lambda(op));
-    return lambda(args_Copy, env);
+    args.push_back(env.get_lambda(op));
+    return lambda(args, env);
   }
 }
 
+// true if the expression contains a define special-form
+bool containsDefine(const Expression &exp) {
+  if (exp.head().isSymbol() && exp.head().asSymbol() == "define")
+    return true;
+  for (auto &e:exp.getTail())
+    if (containsDefine(e))
+      return true;
+  return false;
+}
+
+// Build a function evaluating the named procedure or single argument lambda
+// over a batch of abscissas. A lambda shares one scope across the batch
+// unless its body defines symbols, in which case each call gets a fresh copy.
+BatchFunction plotFunction(const Atom &name, Environment &env) {
+
+  if (env.is_proc(name)) {
+    Procedure proc = env.get_proc(name);
+    return [proc, &env](const std::vector<double> &x, std::vector<double> &y) {
+      std::vector<Expression> args(1);
+      y.resize(x.size());
+      for (std::size_t i = 0; i < x.size(); ++i) {
+        env.checkInterrupt();
+        args[0] = Expression(x[i]);
+        y[i] = proc(args).head().asNumber();
+      }
+    };
+  }
+
+  if (!env.is_lambda(name))
+    throw SemanticError("Error: First argument to continuous-plot not a procedure");
+
+  Expression function = env.get_lambda(name);
+  if (function.getTail().cbegin()->getTail().size() != 1)
+    throw SemanticError("Error: Function given to continuous-plot must take one argument");
+
+  return [function, &env](const std::vector<double> &x, std::vector<double> &y) {
+    const Atom &parameter = function.getTail().cbegin()->getTail().cbegin()->head();
+    const Expression &body = *(function.getTail().cend() - 1);
+    bool freshScope = containsDefine(body);
+
+    auto evaluate = [&](Environment &scope, double value) {
+      if (scope.is_exp(parameter))
+        scope.rem_exp(parameter);
+      scope.add_exp(parameter, Expression(value));
+      Expression call(body);
+      return call.eval(scope).head().asNumber();
+    };
+
+    Environment shared(env);
+    y.resize(x.size());
+    for (std::size_t i = 0; i < x.size(); ++i) {
+      env.checkInterrupt();
+      if (freshScope) {
+        Environment scope(env);
+        y[i] = evaluate(scope, x[i]);
+      } else {
+        y[i] = evaluate(shared, x[i]);
+      }
+    }
+  };
+}
+
+namespace {
+
+// tags of the atom types in an image
+enum AtomTag : char { NoneTag, NumberTag, ComplexTag, SymbolTag, StringTag, ErrorTag };
+
+template<typename T>
+void writeValue(std::string &image, const T &value) {
+  image.append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+void writeText(std::string &image, const std::string &text) {
+  writeValue(image, static_cast<std::uint64_t>(text.size()));
+  image.append(text);
+}
+
+template<typename T>
+bool readValue(const char *&first, const char *last, T &value) {
+  if (static_cast<std::size_t>(last - first) < sizeof(value))
+    return false;
+  std::memcpy(&value, first, sizeof(value));
+  first += sizeof(value);
+  return true;
+}
+
+bool readText(const char *&first, const char *last, std::string &text) {
+  std::uint64_t size;
+  if (!readValue(first, last, size) || static_cast<std::uint64_t>(last - first) < size)
+    return false;
+  text.assign(first, size);
+  first += size;
+  return true;
+}
+
+}
+
+void Expression::serialize(std::string &image) const {
+
+  if (m_head.isNumber()) {
+    image.push_back(NumberTag);
+    writeValue(image, m_head.asNumber());
+  } else if (m_head.isComplex()) {
+    image.push_back(ComplexTag);
+    writeValue(image, m_head.asComplex().real());
+    writeValue(image, m_head.asComplex().imag());
+  } else if (m_head.isSymbol()) {
+    image.push_back(SymbolTag);
+    writeText(image, m_head.asSymbol());
+  } else if (m_head.isString()) {
+    image.push_back(StringTag);
+    writeText(image, m_head.asString());
+  } else if (m_head.isError()) {
+    image.push_back(ErrorTag);
+    writeText(image, m_head.asError());
+  } else {
+    image.push_back(NoneTag);
+  }
+
+  image.push_back(m_Lambda ? 1 : 0);
+
+  const Tail &tail = getTail();
+  writeValue(image, static_cast<std::uint64_t>(tail.size()));
+  for (auto &e:tail)
+    e.serialize(image);
+
+  writeValue(image, static_cast<std::uint64_t>(m_properties.size()));
+  for (auto &property:m_properties) {
+    writeText(image, property.first);
+    property.second.serialize(image);
+  }
+
+  image.push_back(m_geometry == nullptr ? 0 : 1);
+  if (m_geometry != nullptr) {
+    image.push_back(static_cast<char>(m_geometry->kind()));
+    writeValue(image, static_cast<std::uint64_t>(m_geometry->size()));
+    image.append(reinterpret_cast<const char *>(m_geometry->x().data()), m_geometry->size() * sizeof(double));
+    image.append(reinterpret_cast<const char *>(m_geometry->y().data()), m_geometry->size() * sizeof(double));
+  }
+}
+
+bool Expression::deserialize(const char *&first, const char *last, Expression &result) {
+  return deserialize(first, last, result, 0);
+}
+
+bool Expression::deserialize(const char *&first, const char *last, Expression &result, std::size_t depth) {
+
+  // a crafted image must not nest deep enough to overflow the stack
+  if (depth > Limits().depth)
+    return false;
+
+  result = Expression();
+
+  char tag;
+  if (!readValue(first, last, tag))
+    return false;
+  if (tag == NumberTag) {
+    double value;
+    if (!readValue(first, last, value))
+      return false;
+    result.m_head = Atom(value);
+  } else if (tag == ComplexTag) {
+    double real, imag;
+    if (!readValue(first, last, real) || !readValue(first, last, imag))
+      return false;
+    result.m_head = Atom(std::complex<double>(real, imag));
+  } else if (tag == SymbolTag || tag == StringTag || tag == ErrorTag) {
+    std::string text;
+    if (!readText(first, last, text))
+      return false;
+    result.m_head = tag == SymbolTag ? Atom(text) : Atom(text, tag == StringTag);
+  } else if (tag != NoneTag) {
+    return false;
+  }
+
+  char lambda;
+  if (!readValue(first, last, lambda))
+    return false;
+  result.m_Lambda = lambda != 0;
+
+  std::uint64_t count;
+  if (!readValue(first, last, count))
+    return false;
+  for (std::uint64_t i = 0; i < count; ++i) {
+    Expression item;
+    if (!deserialize(first, last, item, depth + 1))
+      return false;
+    result.m_tail.emplace_back(std::move(item));
+  }
+
+  if (!readValue(first, last, count))
+    return false;
+  for (std::uint64_t i = 0; i < count; ++i) {
+    std::string key;
+    Expression value;
+    if (!readText(first, last, key) || !deserialize(first, last, value, depth + 1))
+      return false;
+    result.m_properties.emplace(key, std::move(value));
+  }
+
+  char geometry;
+  if (!readValue(first, last, geometry))
+    return false;
+  if (geometry != 0) {
+    char kind;
+    if (!readValue(first, last, kind) || kind < Geometry::PolylineKind || kind > Geometry::SegmentsKind
+        || !readValue(first, last, count) || static_cast<std::uint64_t>(last - first) / (2 * sizeof(double)) < count)
+      return false;
+    std::vector<double> x(count), y(count);
+    std::memcpy(x.data(), first, count * sizeof(double));
+    first += count * sizeof(double);
+    std::memcpy(y.data(), first, count * sizeof(double));
+    first += count * sizeof(double);
+    result.m_geometry = std::make_shared<Geometry>(static_cast<Geometry::Kind>(kind), std::move(x), std::move(y));
+  }
+
+  return true;
+}
+
 Expression Expression::handle_lookup(const Atom &head, const Environment &env) {
   if (head.isSymbol()) { // if symbol is in env return value
     if (env.is_exp(head)) {
@@ -210,6 +852,7 @@ Expression Expression::handle_begin(Environment &env) {
   // evaluate each arg from tail, return the last
   Expression result;
   for (auto it:m_tail) {
+    env.checkInterrupt();
     result = it.eval(env);
   }
 
@@ -253,8 +896,12 @@ Expression Expression::handle_define(Environment &env) {
 
 Expression Expression::handle_list(Environment &env) {
 
+  if (env.getBudget() != nullptr)
+    env.getBudget()->charge(m_tail.size());
+
   Expression result;
   for (auto it:m_tail) {
+    env.checkInterrupt();
     result.m_tail.push_back(it.eval(env));
   }
 
@@ -296,6 +943,9 @@ Expression Expression::handle_apply(Environment &env) {
   try {
     result = result.eval(env);
   }
+  catch (Interrupted &) {
+    throw;
+  }
   catch (SemanticError &error) {
     std::string errorName = "Error during apply: ";
     errorName.append(error.what());
@@ -320,119 +970,68 @@ Expression Expression::handle_map(Environment &env) {
     m_tail.emplace_back(Evaluate.eval(env));
   }
 
-  Expression result;
+  std::vector<Expression> results;
   Expression entry = Expression(m_tail.cbegin()->head());
-  for (auto a:(m_tail.cbegin() + 1)->getTail()) {
+  auto call = [&](const Expression &a) {
+    env.checkInterrupt();
     entry.m_tail.emplace_back(a);
     try {
-      result.m_tail.emplace_back(entry.eval(env));
+      results.emplace_back(entry.eval(env));
+    } catch (Interrupted &) {
+      throw;
     } catch (SemanticError &error) {
       std::string errorName = "Error during map: ";
       errorName.append(error.what());
       throw SemanticError(errorName);
     }
     entry.m_tail.clear();
+  };
+
+  if (env.getBudget() != nullptr)
+    env.getBudget()->charge((m_tail.cbegin() + 1)->tailSize());
+
+  /// A lazy list is read number by number, never materialized
+  const Sequence *sequence = (m_tail.cbegin() + 1)->getSequence();
+  if (sequence != nullptr) {
+    /// A lazy list may describe more numbers than memory holds, so only a
+    /// little room is reserved up front and the results grow as they are made
+    results.reserve(std::min<std::size_t>(sequence->size(), 4096));
+    for (std::size_t i = 0; i < sequence->size(); ++i)
+      call(Expression(sequence->at(i)));
+  } else {
+    results.reserve((m_tail.cbegin() + 1)->m_tail.size());
+    for (auto &a:(m_tail.cbegin() + 1)->m_tail)
+      call(a);
   }
+
+  Expression result;
+  result.m_tail = Tail(std::move(results));
   return result;
 
 }
 
-Expression Expression::handle_continuousPlot(Environment &env) {
-
-  if (m_tail.size() < 2)
-    throw SemanticError("Error: Invalid number of parameters to continuous-plot");
-
-  if (!(m_tail.cbegin() + 1)->isList())
-    throw SemanticError("Error: Invalid type of argument to continuous-plot");
-
-  /// Deconstruct Parameters
-  Expression lambdaFunction = *m_tail.cbegin();
-  Expression arguments = (m_tail.begin() + 1)->eval(env);
-
-  /// Create Data
-  double stepSize =
-      (arguments.getTail().cbegin()->head().asNumber() - (arguments.getTail().cbegin() + 1)->head().asNumber()) / -50;
-  arguments.getTail().emplace_back(Expression(stepSize));
-  Expression xPositionsExpressions("range");
-  xPositionsExpressions.getTail()
-      .insert(xPositionsExpressions.getTail().end(), arguments.getTail().begin(), arguments.getTail().end());
-  xPositionsExpressions = xPositionsExpressions.eval(env);
-
-  if ((xPositionsExpressions.getTail().cend() - 1)->head().asNumber()
-      != (arguments.getTail().cbegin() + 1)->head().asNumber())
-    xPositionsExpressions.getTail().push_back(*(arguments.getTail().cbegin() + 1));
-
-  Expression yPositionsExpressions("map");
-  yPositionsExpressions.getTail().push_back(lambdaFunction);
-  yPositionsExpressions.getTail().push_back(xPositionsExpressions);
-  yPositionsExpressions = yPositionsExpressions.eval(env);
-
-  /// Create a vector of x and y positions
-  std::vector<double> xPositions;
-  std::vector<double> yPositions;
+// the text of a continuous plot
+struct PlotLabels {
+  bool labelled = false;
+  std::string title;
+  std::string abscissa;
+  std::string ordinate;
+  double textScale = 1;
+};
 
-  for (auto point:xPositionsExpressions.getTail()) {
-    xPositions.emplace_back(point.head().asNumber());
-  }
-  for (auto point:yPositionsExpressions.getTail()) {
-    yPositions.emplace_back(point.head().asNumber());
-  }
+// Assemble a continuous plot of a sampled curve: its frame, axes, labels and the curve
+Expression continuousPlot(std::vector<double> xPositions, std::vector<double> yPositions, const PlotLabels &labels) {
 
   Expression result;
 
-  /// Smooth Lines
-  /// Algorithm is a, b, c where b is vertex.
-  bool antiAliased = true;
-  for (int8_t i = 0; i < 10 && antiAliased; i++) {
-    bool addedPoint = false;
-    antiAliased = false;
-    for (std::size_t it = 0; it < xPositions.size() - 2; it++) {
-      double angle = std::abs((std::atan2(
-          *(yPositions.cbegin() + it + (addedPoint ? 3 : 2)) - *(yPositions.cbegin() + it + (addedPoint ? 2 : 1)),
-          *(xPositions.cbegin() + it + (addedPoint ? 3 : 2)) - *(xPositions.cbegin() + it + (addedPoint ? 2 : 1)))
-          - std::atan2(
-              *(yPositions.cbegin() + it) - *(yPositions.cbegin() + it + (addedPoint ? 2 : 1)),
-              *(xPositions.cbegin() + it)
-                  - *(xPositions.cbegin() + it + (addedPoint ? 2 : 1)))) * -180 / std::atan2(0, -1));
-      if (angle < 175 || angle > 185) {
-        double mid1 = *(xPositions.cbegin() + it)
-            + (*(xPositions.cbegin() + it) - *(xPositions.cbegin() + it + (addedPoint ? 2 : 1))) / 2;
-        double mid2 =
-            *(xPositions.cbegin() + it + (addedPoint ? 2 : 1)) - (*(xPositions.cbegin() + it + (addedPoint ? 3 : 2))
-                - *(xPositions.cbegin() + it + (addedPoint ? 2 : 1))) / 2;
-
-        if (!addedPoint) {
-          lambdaFunction.getTail().clear();
-          lambdaFunction.getTail().emplace_back(Expression(mid1));
-          yPositions.emplace((yPositions.cbegin() + it), lambdaFunction.eval(env).head().asNumber());
-          xPositions.emplace((xPositions.cbegin() + it), mid1);
-        }
-        it++;
-        lambdaFunction.getTail().clear();
-        lambdaFunction.getTail().emplace_back(Expression(mid2));
-        yPositions.emplace((yPositions.cbegin() + it + 1), lambdaFunction.eval(env).head().asNumber());
-        xPositions.emplace((xPositions.cbegin() + it + 1), mid2);
-        addedPoint = true;
-        antiAliased = true;
-      } else {
-        addedPoint = false;
-      }
-    }
-  }
-
   /// Create Scale Factor
   double yMax, xMax, xMin, yMin;
   double xScaleFactor = scaleFactor(xPositions, xMax, xMin);
   double yScaleFactor = scaleFactor(yPositions, yMax, yMin);
 
-  for (auto &x:xPositions) {
-    x = x * xScaleFactor;
-  }
-
   /// You must flip the y value
-  for (auto &y:yPositions) {
-    y = y * -yScaleFactor;
-  }
+  auto curve = std::make_shared<Geometry>(Geometry::PolylineKind, std::move(xPositions), std::move(yPositions));
+  curve->scale(xScaleFactor, -yScaleFactor);
   yMax = -yMax;
   yMin = -yMin;
 
@@ -450,57 +1049,103 @@ Expression Expression::handle_continuousPlot(Environment &env) {
   if (yMax < 0 && yMin > 0)
     result.getTail().emplace_back(Expression(xMax, 0, xMin, 0, 0));
 
-  double textScale = 1;
-  if (m_tail.size() == 3 && (m_tail.cbegin() + 2)->isList()) {
-    Expression properties = (m_tail.begin() + 2)->eval(env);
-
-    /// Get Properties
-    std::string title, abscLabel, ordLabel;
-    for (auto &option:properties.getTail()) {
-      if (option.getTail().cbegin()->head().asString() == "title")
-        title = (option.getTail().cbegin() + 1)->head().asString();
-      else if (option.getTail().cbegin()->head().asString() == "abscissa-label")
-        abscLabel = (option.getTail().cbegin() + 1)->head().asString();
-      else if (option.getTail().cbegin()->head().asString() == "ordinate-label")
-        ordLabel = (option.getTail().cbegin() + 1)->head().asString();
-      else if (option.getTail().cbegin()->head().asString() == "text-scale")
-        textScale = (option.getTail().cbegin() + 1)->head().asNumber();
-    }
-
+  if (labels.labelled) {
     /// Add Graph Labels
-    result.getTail().emplace_back(Expression(title, xMax - ((xMax - xMin) / 2), (yMax - 3), textScale, 0));
-    result.getTail().emplace_back(Expression(abscLabel, xMax - ((xMax - xMin) / 2), (yMin + 3), textScale, 0));
-    result.getTail().emplace_back(Expression(ordLabel,
+    result.getTail().emplace_back(Expression(labels.title, xMax - ((xMax - xMin) / 2), (yMax - 3), labels.textScale, 0));
+    result.getTail().emplace_back(Expression(labels.abscissa, xMax - ((xMax - xMin) / 2), (yMin + 3), labels.textScale, 0));
+    result.getTail().emplace_back(Expression(labels.ordinate,
                                              (xMin - 3),
                                              yMin - (yMin - yMax) / 2,
-                                             textScale,
+                                             labels.textScale,
                                              -std::atan2(0, -1) / 2));
   }
   /// Add Graph number labels
   std::stringstream ss;
   ss << std::setprecision(2);
   ss << yMax / -yScaleFactor;
-  result.getTail().emplace_back(Expression(ss.str(), (xMin - 2), yMax, textScale, 0));
+  result.getTail().emplace_back(Expression(ss.str(), (xMin - 2), yMax, labels.textScale, 0));
   ss.str("");
   ss << yMin / -yScaleFactor;
-  result.getTail().emplace_back(Expression(ss.str(), (xMin - 2), yMin, textScale, 0));
+  result.getTail().emplace_back(Expression(ss.str(), (xMin - 2), yMin, labels.textScale, 0));
   ss.str("");
   ss << xMax / xScaleFactor;
-  result.getTail().emplace_back(Expression(ss.str(), xMax, (yMin + 2), textScale, 0));
+  result.getTail().emplace_back(Expression(ss.str(), xMax, (yMin + 2), labels.textScale, 0));
   ss.str("");
   ss << xMin / xScaleFactor;
-  result.getTail().emplace_back(Expression(ss.str(), xMin, (yMin + 2), textScale, 0));
+  result.getTail().emplace_back(Expression(ss.str(), xMin, (yMin + 2), labels.textScale, 0));
 
+  /// Add the curve
+  result.getTail().emplace_back(Expression(std::shared_ptr<const Geometry>(curve), 0));
 
+  return result;
+}
 
-  /// Add Lines
-  for (std::size_t it = 0; it < xPositions.size() - 1; it++) {
-    result.getTail().emplace_back(Expression(*(xPositions.cbegin() + it), *(yPositions.cbegin() + it),
-                                             *(xPositions.cbegin() + it + 1), *(yPositions.cbegin() + it + 1), 0));
+Expression Expression::handle_continuousPlot(Environment &env) {
+
+  if (m_tail.size() < 2)
+    throw SemanticError("Error: Invalid number of parameters to continuous-plot");
+
+  if (!(m_tail.cbegin() + 1)->isList())
+    throw SemanticError("Error: Invalid type of argument to continuous-plot");
+
+  /// Deconstruct Parameters
+  Expression arguments = (m_tail.begin() + 1)->eval(env);
+  if (arguments.getTail().size() != 2 || !arguments.getTail().cbegin()->isHeadNumber()
+      || !(arguments.getTail().cbegin() + 1)->isHeadNumber())
+    throw SemanticError("Error: Invalid type of argument to continuous-plot");
+  double lower = arguments.getTail().cbegin()->head().asNumber();
+  double upper = (arguments.getTail().cbegin() + 1)->head().asNumber();
+  if (lower >= upper)
+    throw SemanticError("Error: Invalid bounds to continuous-plot");
+
+  /// Get Properties
+  PlotLabels labels;
+  labels.labelled = m_tail.size() == 3 && (m_tail.cbegin() + 2)->isList();
+  SamplerOptions sampling;
+  if (labels.labelled) {
+    Expression properties = (m_tail.begin() + 2)->eval(env);
+    for (auto &option:properties.getTail()) {
+      if (option.getTail().cbegin()->head().asString() == "title")
+        labels.title = (option.getTail().cbegin() + 1)->head().asString();
+      else if (option.getTail().cbegin()->head().asString() == "abscissa-label")
+        labels.abscissa = (option.getTail().cbegin() + 1)->head().asString();
+      else if (option.getTail().cbegin()->head().asString() == "ordinate-label")
+        labels.ordinate = (option.getTail().cbegin() + 1)->head().asString();
+      else if (option.getTail().cbegin()->head().asString() == "text-scale")
+        labels.textScale = (option.getTail().cbegin() + 1)->head().asNumber();
+      else if (option.getTail().cbegin()->head().asString() == "sample-budget") {
+        /// a budget outside the range of std::size_t cannot be converted
+        const Atom &budget = (option.getTail().cbegin() + 1)->head();
+        if (!budget.isNumber() || !(budget.asNumber() >= 1)
+            || !(budget.asNumber() < static_cast<double>(std::numeric_limits<std::size_t>::max())))
+          throw SemanticError("Error: sample-budget to continuous-plot not a positive number");
+        sampling.budget = static_cast<std::size_t>(budget.asNumber());
+      }
+      else if (option.getTail().cbegin()->head().asString() == "angle-tolerance")
+        sampling.angleTolerance = (option.getTail().cbegin() + 1)->head().asNumber();
+      else if (option.getTail().cbegin()->head().asString() == "error-tolerance")
+        sampling.errorTolerance = (option.getTail().cbegin() + 1)->head().asNumber();
+    }
   }
 
-  return result;
+  /// Sample the function, refining where the curve bends
+  std::vector<double> xPositions;
+  std::vector<double> yPositions;
+  AdaptiveSampler sampler(sampling);
+
+  /// Report the plot of the curve sampled so far before each refinement,
+  /// built only when the receiver wants one
+  SampleProgress progress;
+  if (env.getProgress() != nullptr) {
+    const Progress &stream = *env.getProgress();
+    progress = [&stream, &labels](const std::vector<double> &x, const std::vector<double> &y) {
+      if (!stream.wanted || stream.wanted())
+        stream.report(continuousPlot(x, y, labels));
+    };
+  }
+  sampler.sample(plotFunction(m_tail.cbegin()->head(), env), lower, upper, xPositions, yPositions, progress);
 
+  return continuousPlot(std::move(xPositions), std::move(yPositions), labels);
 }
 
 // this is a simple recursive version. the iterative version is more
@@ -508,7 +1153,9 @@ Expression Expression::handle_continuousPlot(Environment &env) {
 // this limits the practical depth of our AST
 Expression Expression::eval(Environment &env) {
 
-  if (m_tail.empty()) {
+  Budget::Frame frame(env.getBudget());
+
+  if (m_tail.empty() && m_lazy == nullptr) {
     return handle_lookup(m_head, env);
   }
     // handle begin special-form
@@ -537,7 +1184,9 @@ Expression Expression::eval(Environment &env) {
     // else attempt to treat as procedure
   else {
     std::vector<Expression> results;
-    for (auto it:m_tail) {
+    results.reserve(m_tail.size() + 1);
+    for (auto &it:m_tail) {
+      env.checkInterrupt();
       results.push_back(it.eval(env));
     }
     return apply(m_head, results, env);
@@ -551,6 +1200,18 @@ std::ostream &operator<<(std::ostream &out, const Expression &exp) {
     return out;
   }
 
+  if (exp.getGeometry() != nullptr) {
+    const Geometry &geometry = *exp.getGeometry();
+    out << "(";
+    for (std::size_t i = 0; i < geometry.size(); ++i) {
+      out << "((" << geometry.x()[i] << ") (" << geometry.y()[i] << "))";
+      if (i + 1 != geometry.size())
+        out << " ";
+    }
+    out << ")";
+    return out;
+  }
+
   if (exp.head().isNone() && exp.getTail().empty()) {
     out << "NONE";
     return out;
@@ -576,9 +1237,24 @@ bool Expression::operator==(const Expression &exp) const noexcept {
 
   bool result = (m_head == exp.m_head);
 
-  result = result && (m_tail.size() == exp.m_tail.size());
-
-  if (result) {
+  result = result && (tailSize() == exp.tailSize());
+
+  result = result && ((m_geometry == nullptr && exp.m_geometry == nullptr)
+      || (m_geometry != nullptr && exp.m_geometry != nullptr && *m_geometry == *exp.m_geometry));
+
+  // the numbers of a lazy list are compared without building its tail
+  if (result && m_lazy != nullptr && exp.m_lazy != nullptr) {
+    for (std::size_t i = 0; result && i < m_lazy->sequence->size(); ++i)
+      result = Atom(m_lazy->sequence->at(i)) == Atom(exp.m_lazy->sequence->at(i));
+  } else if (result && m_lazy != nullptr) {
+    auto righte = exp.m_tail.begin();
+    for (std::size_t i = 0; result && i < m_lazy->sequence->size(); ++i, ++righte)
+      result = *righte == Expression(m_lazy->sequence->at(i));
+  } else if (result && exp.m_lazy != nullptr) {
+    auto lefte = m_tail.begin();
+    for (std::size_t i = 0; result && i < exp.m_lazy->sequence->size(); ++i, ++lefte)
+      result = *lefte == Expression(exp.m_lazy->sequence->at(i));
+  } else if (result) {
     for (auto lefte = m_tail.begin(), righte = exp.m_tail.begin();
          (lefte != m_tail.end()) && (righte != exp.m_tail.end());
          ++lefte, ++righte) {
@@ -589,14 +1265,31 @@ bool Expression::operator==(const Expression &exp) const noexcept {
   return result;
 }
 
+bool Expression::hasObjectName(const char *name) const noexcept {
+  const Expression *objectName = findProperty("object-name");
+  return objectName != nullptr && objectName->head().isString() && objectName->tailSize() == 0
+      && objectName->head().asString() == name;
+}
 bool Expression::isPoint() const noexcept {
-  return this->getProperty("object-name") == Expression("point", true);
+  return hasObjectName("point");
 }
 bool Expression::isLine() const noexcept {
-  return this->getProperty("object-name") == Expression("line", true);
+  return hasObjectName("line");
 }
 bool Expression::isText() const noexcept {
-  return this->getProperty("object-name") == Expression("text", true);
+  return hasObjectName("text");
+}
+bool Expression::isPolyline() const noexcept {
+  return m_geometry != nullptr && m_geometry->kind() == Geometry::PolylineKind;
+}
+bool Expression::isPointCloud() const noexcept {
+  return m_geometry != nullptr && m_geometry->kind() == Geometry::PointCloudKind;
+}
+bool Expression::isLineSegments() const noexcept {
+  return m_geometry != nullptr && m_geometry->kind() == Geometry::SegmentsKind;
+}
+const Geometry *Expression::getGeometry() const noexcept {
+  return m_geometry.get();
 }
 
 Expression::Expression(const double &x, const double &y, const double &size) {
@@ -632,6 +1325,27 @@ Expression::Expression(const std::string &text,
   addProperty("text-rotation", Expression(rotation));
 }
 
+Expression::Expression(const std::shared_ptr<const Geometry> &geometry, const double &style) {
+
+  m_geometry = geometry;
+  if (geometry->kind() == Geometry::PointCloudKind) {
+    addProperty("size", Expression(style));
+    addProperty("object-name", Expression("point-cloud", true));
+  } else {
+    addProperty("thickness", Expression(style));
+    addProperty("object-name", Expression(geometry->kind() == Geometry::PolylineKind ? "polyline" : "line-segments", true));
+  }
+}
+
+Expression::Expression(const std::shared_ptr<const Sequence> &sequence) {
+
+  // an empty list is represented by its empty symbol head
+  if (sequence->size() == 0)
+    m_head = Atom("");
+  else
+    m_lazy = std::make_shared<Lazy>(sequence);
+}
+
 bool operator!=(const Expression &left, const Expression &right) noexcept {
 
   return !(left == right);
@@ -639,19 +1353,23 @@ bool operator!=(const Expression &left, const Expression &right) noexcept {
 
 double scaleFactor(const std::vector<double> &positions, double &max, double &min) {
 
-  max = *positions.cbegin();
-  min = *positions.cbegin();
-  for (auto &pos:positions) {
-    if (max < pos)
-      max = pos;
-    if (min > pos)
-      min = pos;
+  return scaleFactor(positions.data(), positions.data() + positions.size(), max, min);
+}
+
+double scaleFactor(const double *first, const double *last, double &max, double &min) {
+
+  // branch free reductions so the loop can be vectorized
+  double high = *first;
+  double low = *first;
+  std::size_t count = last - first;
+  for (std::size_t i = 0; i < count; ++i) {
+    high = first[i] > high ? first[i] : high;
+    low = first[i] < low ? first[i] : low;
   }
 
-  double scaleFact = 20 / (max - min);
-  max *= scaleFact;
-  min *= scaleFact;
+  double scaleFact = 20 / (high - low);
+  max = high * scaleFact;
+  min = low * scaleFact;
 
   return scaleFact;
 }
-
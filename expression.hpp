@@ -8,13 +8,256 @@ Defines the Expression type and assiciated functions.
 #include <vector>
 #include <map>
 #include <atomic>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
 
 #include "token.hpp"
 #include "atom.hpp"
+#include "geometry.hpp"
+#include "sequence.hpp"
 
 // forward declare Environment
 class Environment;
 
+class Expression;
+
+/*! \class Tail
+\brief The list of expressions following the head of an Expression.
+
+A Tail is a view of a range of a persistent vector: a balanced tree whose
+leaves hold up to 32 consecutive expressions and whose nodes copies share.
+Copying a Tail or taking a slice of it is constant time. Reading an
+expression, appending one, inserting one and joining two Tails are
+O(log n), copying only the nodes along one path and sharing the rest.
+The interface follows std::vector. A member that can modify the
+expressions first copies the nodes it changes that another Tail shares,
+so a change is never seen through another copy. Any change invalidates
+iterators, as it does for std::vector.
+ */
+class Tail {
+ private:
+
+  struct Node;
+
+ public:
+
+  /*! \class Iterator
+  \brief A random access iterator over a Tail.
+
+  It keeps the leaf it last read, so stepping through a Tail finds a leaf
+  once per leaf rather than once per expression.
+   */
+  template<typename T>
+  class Iterator {
+   public:
+
+    typedef std::random_access_iterator_tag iterator_category;
+    typedef Expression value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef T *pointer;
+    typedef T &reference;
+
+    Iterator() = default;
+
+    /// an iterator converts to a const_iterator
+    template<typename U, typename = typename std::enable_if<std::is_convertible<U *, T *>::value>::type>
+    Iterator(const Iterator<U> &other)
+        : m_root(other.m_root), m_offset(other.m_offset), m_index(other.m_index) {}
+
+    reference operator*() const {
+      if (m_index - m_first >= m_count)
+        seek();
+      return m_items[m_index - m_first];
+    }
+
+    pointer operator->() const {
+      return &**this;
+    }
+
+    reference operator[](difference_type n) const {
+      return *(*this + n);
+    }
+
+    Iterator &operator++() {
+      ++m_index;
+      return *this;
+    }
+
+    Iterator operator++(int) {
+      Iterator result(*this);
+      ++m_index;
+      return result;
+    }
+
+    Iterator &operator--() {
+      --m_index;
+      return *this;
+    }
+
+    Iterator operator--(int) {
+      Iterator result(*this);
+      --m_index;
+      return result;
+    }
+
+    Iterator &operator+=(difference_type n) {
+      m_index += n;
+      return *this;
+    }
+
+    Iterator &operator-=(difference_type n) {
+      m_index -= n;
+      return *this;
+    }
+
+    Iterator operator+(difference_type n) const {
+      Iterator result(*this);
+      return result += n;
+    }
+
+    Iterator operator-(difference_type n) const {
+      Iterator result(*this);
+      return result -= n;
+    }
+
+    difference_type operator-(const Iterator &other) const {
+      return static_cast<difference_type>(m_index) - static_cast<difference_type>(other.m_index);
+    }
+
+    bool operator==(const Iterator &other) const {
+      return m_index == other.m_index;
+    }
+
+    bool operator!=(const Iterator &other) const {
+      return m_index != other.m_index;
+    }
+
+    bool operator<(const Iterator &other) const {
+      return m_index < other.m_index;
+    }
+
+    bool operator>(const Iterator &other) const {
+      return m_index > other.m_index;
+    }
+
+    bool operator<=(const Iterator &other) const {
+      return m_index <= other.m_index;
+    }
+
+    bool operator>=(const Iterator &other) const {
+      return m_index >= other.m_index;
+    }
+
+   private:
+
+    friend class Tail;
+    template<typename> friend class Iterator;
+
+    Iterator(const Node *root, std::size_t offset, std::size_t index)
+        : m_root(root), m_offset(offset), m_index(index) {}
+
+    // find the leaf holding m_index
+    void seek() const;
+
+    const Node *m_root = nullptr;
+
+    // the index in the tree of the first expression of the Tail
+    std::size_t m_offset = 0;
+
+    // the index in the Tail of the expression referred to
+    std::size_t m_index = 0;
+
+    // the expressions of the last leaf read that are in the Tail,
+    // m_items[0] being the expression at m_first
+    mutable T *m_items = nullptr;
+    mutable std::size_t m_first = 0;
+    mutable std::size_t m_count = 0;
+  };
+
+  typedef Iterator<Expression> iterator;
+  typedef Iterator<const Expression> const_iterator;
+
+  Tail() = default;
+
+  /// a Tail of the expressions of items
+  explicit Tail(std::vector<Expression> &&items);
+
+  /// copies share the nodes
+  Tail(const Tail &) = default;
+  Tail &operator=(const Tail &) = default;
+
+  /// moves take the nodes, leaving the source empty
+  Tail(Tail &&other) noexcept;
+  Tail &operator=(Tail &&other) noexcept;
+
+  /// the number of expressions
+  std::size_t size() const noexcept;
+
+  /// true if there are no expressions
+  bool empty() const noexcept;
+
+  /// iterators over the expressions without copying any node
+  const_iterator begin() const noexcept;
+  const_iterator end() const noexcept;
+  const_iterator cbegin() const noexcept;
+  const_iterator cend() const noexcept;
+
+  /// iterators over the expressions that may modify them
+  iterator begin();
+  iterator end();
+
+  /// the expression at index, which must be less than size()
+  const Expression &operator[](std::size_t index) const noexcept;
+  Expression &operator[](std::size_t index);
+
+  /// the last expression, the tail must not be empty
+  const Expression &back() const noexcept;
+  Expression &back();
+
+  /// construct an expression at the end
+  template<typename... Args>
+  void emplace_back(Args &&... args);
+
+  /// copy an expression to the end
+  void push_back(const Expression &value);
+
+  /// remove the last expression
+  void pop_back() noexcept;
+
+  /// insert a copy of value before position
+  void insert(const_iterator position, const Expression &value);
+
+  /// add the expressions of other at the end, sharing its nodes
+  void join(const Tail &other);
+
+  /// remove every expression
+  void clear() noexcept;
+
+  /// a Tail of length expressions starting at offset, sharing these nodes
+  Tail slice(std::size_t offset, std::size_t length) const noexcept;
+
+ private:
+
+  // the functions over nodes, defined with them
+  struct Tree;
+
+  std::shared_ptr<Node> m_root;
+
+  // the view of the tree, the expressions outside it are never read
+  std::size_t m_offset = 0;
+
+  std::size_t m_length = 0;
+
+  // make the tree hold exactly the view
+  void trim();
+
+  // add value at the end
+  void append(Expression &&value);
+};
+
 /*! \class Expression
 \brief An expression is a tree of Atoms.
 
@@ -24,7 +267,7 @@ list of expressions called the tail.
 class Expression {
  public:
 
-  typedef std::vector<Expression>::const_iterator ConstIteratorType;
+  typedef Tail::const_iterator ConstIteratorType;
 
   /// Default construct and Expression, whose type in NoneType
   Expression() = default;
@@ -34,9 +277,12 @@ class Expression {
   */
   explicit Expression(const Atom &a);
 
-  /// deep-copy construct an expression (recursive)
+  /// copy construct an expression, sharing the tail
   Expression(const Expression &a);
 
+  /// move construct an expression
+  Expression(Expression &&a) noexcept = default;
+
   /// Construct Expression with double
   explicit Expression(const double &value);
 
@@ -62,9 +308,18 @@ class Expression {
                       const double &scale,
                       const double &rotation);
 
-  /// deep-copy assign an expression  (recursive)
+  /// Construct Expression as a polyline, point cloud or set of line segments sharing one style
+  explicit Expression(const std::shared_ptr<const Geometry> &geometry, const double &style);
+
+  /// Construct Expression as a list of numbers read from a sequence when accessed
+  explicit Expression(const std::shared_ptr<const Sequence> &sequence);
+
+  /// copy assign an expression, sharing the tail
   Expression &operator=(const Expression &a);
 
+  /// move assign an expression
+  Expression &operator=(Expression &&a) noexcept = default;
+
   /// return a reference to the head Atom
   Atom &head();
 
@@ -77,17 +332,26 @@ class Expression {
   /// return a pointer to the last expression in the tail, or nullptr
   Expression *tail();
 
-  /// return the tail
-  const std::vector<Expression> &getTail() const;
+  /// return the tail, materializing a sequence backed list
+  const Tail &getTail() const;
+
+  /// return the tail, materializing a sequence backed list
+  Tail &getTail();
+
+  /// return the number of expressions in the tail without materializing it
+  std::size_t tailSize() const noexcept;
 
-  /// return the tail
-  std::vector<Expression> &getTail();
+  /// return the sequence backing a lazy list, or nullptr
+  const Sequence *getSequence() const noexcept;
 
-  /// return a const-iterator to the beginning of tail
-  ConstIteratorType tailConstBegin() const noexcept;
+  /// return the list of length expressions of the tail starting at offset, sharing its storage
+  Expression slice(std::size_t offset, std::size_t length) const;
 
-  /// return a const-iterator to the tail end
-  ConstIteratorType tailConstEnd() const noexcept;
+  /// return a const-iterator to the beginning of tail, materializing a sequence backed list
+  ConstIteratorType tailConstBegin() const;
+
+  /// return a const-iterator to the tail end, materializing a sequence backed list
+  ConstIteratorType tailConstEnd() const;
 
   /// convienience member to determine if head atom is a number
   bool isHeadNumber() const noexcept;
@@ -116,11 +380,42 @@ class Expression {
   /// convienience member to determine if the expression is a text
   bool isText() const noexcept;
 
+  /// convienience member to determine if the expression is a polyline
+  bool isPolyline() const noexcept;
+
+  /// convienience member to determine if the expression is a point cloud
+  bool isPointCloud() const noexcept;
+
+  /// convienience member to determine if the expression is a set of line segments
+  bool isLineSegments() const noexcept;
+
+  /// return the packed coordinates of the expression, or nullptr
+  const Geometry *getGeometry() const noexcept;
+
   /// Add a property to Expression
   void addProperty(const std::string &key, const Expression &value);
 
   /// Get value of a property from Expression
-  Expression getProperty(std::string key) const;
+  Expression getProperty(const std::string &key) const;
+
+  /// return a pointer to the value of a property without copying it, or nullptr if it is not set
+  const Expression *findProperty(const std::string &key) const noexcept;
+
+  /*! Append a binary encoding of the expression to an image.
+
+    The encoding is for this machine only, it is not portable.
+    \param image the bytes to append to
+   */
+  void serialize(std::string &image) const;
+
+  /*! Decode an expression written by serialize.
+    \param first the first byte to decode, advanced past the expression
+    \param last one past the last byte that may be read
+    \param result receives the expression
+    \return false if the bytes do not hold an expression, or hold one nested
+            deeper than the default depth limit of an evaluation
+   */
+  static bool deserialize(const char *&first, const char *last, Expression &result);
 
   /// Evaluate expression using a post-order traversal (recursive)
   Expression eval(Environment &env);
@@ -135,15 +430,33 @@ class Expression {
 
   bool m_Lambda = false;
 
-  // the tail list is expressed as a vector for access efficiency
-  // and cache coherence, at the cost of wasted memory.
-  std::vector<Expression> m_tail;
+  // the tail list is expressed as a view of a shared vector for access
+  // efficiency and cache coherence, at the cost of wasted memory.
+  Tail m_tail;
+
+  // the numbers of a lazy list and the tail built from them the first
+  // time it is read, shared by copies
+  struct Lazy;
+  std::shared_ptr<Lazy> m_lazy;
 
   // List of Properties
   std::map<std::string, Expression> m_properties;
 
+  // packed coordinates of a polyline, point cloud or line segments,
+  // immutable so that copies can share them
+  std::shared_ptr<const Geometry> m_geometry;
+
   // convenience typedef
-  typedef std::vector<Expression>::iterator IteratorType;
+  typedef Tail::iterator IteratorType;
+
+  // move the tail of a lazy list into m_tail
+  void materialize();
+
+  // decode an expression nested depth levels inside the one being deserialized
+  static bool deserialize(const char *&first, const char *last, Expression &result, std::size_t depth);
+
+  // true if the object-name property is the string name
+  bool hasObjectName(const char *name) const noexcept;
 
   // internal helper methods
   Expression handle_lookup(const Atom &head, const Environment &env);
@@ -165,4 +478,13 @@ bool operator!=(const Expression &left, const Expression &right) noexcept;
 /// Creates the scalefactor for the graphs and gets their Min and Max
 double scaleFactor(const std::vector<double> &positions, double &max, double &min);
 
+/// Creates the scalefactor for the values in [first, last) and gets their Min and Max
+double scaleFactor(const double *first, const double *last, double &max, double &min);
+
+template<typename... Args>
+void Tail::emplace_back(Args &&... args) {
+  // construct first, the arguments may refer into this buffer
+  append(Expression(std::forward<Args>(args)...));
+}
+
 #endif
@@ -1,5 +1,6 @@
 #include "catch.hpp"
 
+#include "budget.hpp"
 #include "expression.hpp"
 
 TEST_CASE("Test default expression", "[expression]") {
@@ -35,3 +36,177 @@ TEST_CASE("Test complex expression", "[expression]") {
   REQUIRE(!exp.isHeadSymbol());
   REQUIRE(exp.isHeadComplex());
 }
+
+TEST_CASE("Test sequence expression", "[expression]") {
+
+  Expression exp(std::shared_ptr<const Sequence>(std::make_shared<RangeSequence>(0, 1, 0.25)));
+
+  REQUIRE(exp.isList());
+  REQUIRE(exp.getSequence() != nullptr);
+  REQUIRE(exp.tailSize() == 5);
+
+  Expression copy(exp);
+  REQUIRE(copy.getSequence() == exp.getSequence());
+  bool equal = copy == exp;
+  REQUIRE(equal);
+  REQUIRE(copy.getSequence() != nullptr);
+
+  REQUIRE(exp.getTail().size() == 5);
+  REQUIRE(exp.getSequence() == nullptr);
+  REQUIRE(exp.getTail()[3] == Expression(0.75));
+  REQUIRE(copy.getSequence() != nullptr);
+  REQUIRE(copy == exp);
+
+  Expression empty(std::shared_ptr<const Sequence>(std::make_shared<PackedSequence>(std::vector<double>())));
+  REQUIRE(empty.isList());
+  REQUIRE(empty.tailSize() == 0);
+}
+
+TEST_CASE("Test range sequence length", "[expression]") {
+
+  RangeSequence hundredths(0, 100, 0.01);
+  REQUIRE(hundredths.size() == 10001);
+  REQUIRE(hundredths.at(hundredths.size() - 1) <= 100);
+
+  RangeSequence tenths(0.1, 0.3, 0.1);
+  REQUIRE(tenths.size() == 2);
+  REQUIRE(tenths.at(1) <= 0.3);
+
+  /// steps below the precision of the values still end
+  RangeSequence large(0, 1e17, 1);
+  REQUIRE(large.size() == 100000000000000001u);
+  REQUIRE(large.at(large.size() - 1) <= 1e17);
+
+  REQUIRE(RangeSequence(1, 0, 1).size() == 0);
+  REQUIRE(RangeSequence(2, 2, 1).size() == 1);
+}
+
+TEST_CASE("Test tail slices share storage until changed", "[expression]") {
+
+  Expression list;
+  for (int i = 0; i < 4; ++i)
+    list.getTail().emplace_back(Expression(i));
+
+  Expression copy(list);
+  const Expression &constCopy = copy;
+  const Expression &constList = list;
+  REQUIRE(&*constCopy.getTail().cbegin() == &*constList.getTail().cbegin());
+
+  Expression rest = list.slice(1, 3);
+  REQUIRE(rest.getTail().size() == 3);
+  const Expression &constRest = rest;
+  REQUIRE(&*constRest.getTail().cbegin() == &*(constList.getTail().cbegin() + 1));
+
+  copy.getTail()[0] = Expression(10);
+  rest.getTail().emplace_back(Expression(4));
+  REQUIRE(list.getTail()[0] == Expression(0));
+  REQUIRE(list.getTail().size() == 4);
+  REQUIRE(copy.getTail()[0] == Expression(10));
+  REQUIRE(rest.getTail()[3] == Expression(4));
+
+  REQUIRE(list.slice(2, 0).isList());
+  REQUIRE(list.slice(2, 0).getTail().empty());
+}
+
+TEST_CASE("Test appending to a shared tail", "[expression]") {
+
+  Expression list;
+  for (int i = 0; i < 1000; ++i)
+    list.getTail().emplace_back(Expression(i));
+  const Expression &constList = list;
+
+  /// a list no copy shares appends in place
+  const Expression *first = &constList.getTail()[0];
+  list.getTail().emplace_back(Expression(1000));
+  REQUIRE(&constList.getTail()[0] == first);
+
+  /// a copy shares every leaf but the one it appends to
+  Expression longer(list);
+  longer.getTail().emplace_back(Expression(1001));
+  const Expression &constLonger = longer;
+  REQUIRE(&constLonger.getTail()[0] == first);
+  REQUIRE(&constLonger.getTail()[500] == &constList.getTail()[500]);
+  REQUIRE(&constLonger.getTail()[1000] != &constList.getTail()[1000]);
+  REQUIRE(list.getTail().size() == 1001);
+  REQUIRE(longer.getTail().size() == 1002);
+  REQUIRE(longer.getTail()[1001] == Expression(1001));
+
+  /// so does a join, which leaves both lists unchanged
+  Expression joined(list);
+  joined.getTail().join(constLonger.getTail());
+  const Expression &constJoined = joined;
+  REQUIRE(joined.getTail().size() == 2003);
+  REQUIRE(&constJoined.getTail()[0] == first);
+  REQUIRE(&constJoined.getTail()[1001 + 500] == &constList.getTail()[500]);
+  for (std::size_t i = 0; i < 2003; ++i)
+    REQUIRE(constJoined.getTail()[i] == Expression(i < 1001 ? i : i - 1001));
+  REQUIRE(list.getTail().size() == 1001);
+  REQUIRE(longer.getTail().size() == 1002);
+
+  /// changing a copy never changes the original
+  joined.getTail()[3] = Expression(-1);
+  joined.getTail().insert(constJoined.getTail().cbegin() + 10, Expression(-2));
+  REQUIRE(constJoined.getTail()[10] == Expression(-2));
+  REQUIRE(constJoined.getTail()[11] == Expression(10));
+  REQUIRE(constList.getTail()[3] == Expression(3));
+  REQUIRE(constList.getTail()[10] == Expression(10));
+  REQUIRE(&constList.getTail()[0] == first);
+
+  /// appending to a slice drops the expressions after it
+  Expression front = list.slice(0, 40);
+  front.getTail().emplace_back(Expression(-3));
+  REQUIRE(front.getTail().size() == 41);
+  REQUIRE(front.getTail()[40] == Expression(-3));
+  REQUIRE(constList.getTail()[40] == Expression(40));
+}
+
+TEST_CASE("Test finding a property by reference", "[expression]") {
+
+  Expression exp(1, 2, 3);
+
+  const Expression *size = exp.findProperty("size");
+  REQUIRE(size != nullptr);
+  REQUIRE(*size == Expression(3.));
+  REQUIRE(exp.findProperty("thickness") == nullptr);
+  REQUIRE(exp.isPoint());
+
+  exp.addProperty("size", Expression(4.));
+  REQUIRE(exp.findProperty("size") == size);
+  REQUIRE(*size == Expression(4.));
+}
+
+TEST_CASE("Test serializing an expression", "[expression]") {
+
+  Expression list;
+  list.getTail().emplace_back(Expression(std::complex<double>(1, 2)));
+  list.getTail().emplace_back(Expression(std::string("text"), true));
+  list.getTail().emplace_back(Expression(1, 2, 3, 4, 5));
+  list.addProperty("note", Expression(std::string("a list"), true));
+
+  std::string image;
+  list.serialize(image);
+
+  const char *first = image.data();
+  Expression result;
+  REQUIRE(Expression::deserialize(first, image.data() + image.size(), result));
+  REQUIRE(first == image.data() + image.size());
+  REQUIRE(result == list);
+  REQUIRE(result.getProperty("note") == Expression(std::string("a list"), true));
+  REQUIRE(result.getTail()[2].isLine());
+
+  /// truncated images are rejected
+  first = image.data();
+  REQUIRE_FALSE(Expression::deserialize(first, image.data() + image.size() / 2, result));
+
+  /// so are images nested deeper than an evaluation may go
+  Expression nested(1.);
+  for (std::size_t i = 0; i < Limits().depth + 1; ++i) {
+    Expression outer;
+    outer.getTail().emplace_back(std::move(nested));
+    nested = std::move(outer);
+  }
+  image.clear();
+  nested.serialize(image);
+  first = image.data();
+  REQUIRE_FALSE(Expression::deserialize(first, image.data() + image.size(), result));
+}
@@ -0,0 +1,65 @@
+#include "geometry.hpp"
+
+#include <utility>
+
+#include "atom.hpp"
+
+Geometry::Geometry(Kind kind) : m_kind(kind) {}
+
+Geometry::Geometry(Kind kind, std::vector<double> &&x, std::vector<double> &&y)
+    : m_kind(kind), m_x(std::move(x)), m_y(std::move(y)) {
+  if (m_y.size() > m_x.size())
+    m_y.resize(m_x.size());
+  else
+    m_x.resize(m_y.size());
+}
+
+Geometry::Kind Geometry::kind() const noexcept {
+  return m_kind;
+}
+
+std::size_t Geometry::size() const noexcept {
+  return m_x.size();
+}
+
+const std::vector<double> &Geometry::x() const noexcept {
+  return m_x;
+}
+
+const std::vector<double> &Geometry::y() const noexcept {
+  return m_y;
+}
+
+void Geometry::add(double x, double y) {
+  m_x.push_back(x);
+  m_y.push_back(y);
+}
+
+void Geometry::scale(double xFactor, double yFactor) noexcept {
+  scaleValues(m_x.data(), m_x.data() + m_x.size(), xFactor);
+  scaleValues(m_y.data(), m_y.data() + m_y.size(), yFactor);
+}
+
+bool Geometry::operator==(const Geometry &right) const noexcept {
+
+  if (m_kind != right.m_kind || m_x.size() != right.m_x.size())
+    return false;
+
+  for (std::size_t i = 0; i < m_x.size(); ++i) {
+    if (Epsilon(m_x[i], right.m_x[i]) || Epsilon(m_y[i], right.m_y[i]))
+      return false;
+  }
+
+  return true;
+}
+
+bool operator!=(const Geometry &left, const Geometry &right) noexcept {
+
+  return !(left == right);
+}
+
+void scaleValues(double *first, double *last, double factor) noexcept {
+  std::size_t count = last - first;
+  for (std::size_t i = 0; i < count; ++i)
+    first[i] *= factor;
+}
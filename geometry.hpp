@@ -0,0 +1,74 @@
+/*! \file geometry.hpp
+Defines the Geometry type holding packed plot coordinates.
+ */
+#ifndef GEOMETRY_HPP
+#define GEOMETRY_HPP
+
+#include <cstddef>
+#include <vector>
+
+/*! \class Geometry
+\brief Coordinates of many graphic primitives stored in contiguous arrays.
+
+A Geometry is one of a polyline (consecutive points joined by lines), a point
+cloud, or a set of line segments (each pair of points is one segment). The
+style shared by every primitive is stored as a property of the Expression
+holding the Geometry, not per point.
+
+This class provides value semantics.
+ */
+class Geometry {
+ public:
+
+  /*! \enum Kind
+    \brief how the points of a Geometry are drawn.
+   */
+  enum Kind { PolylineKind, PointCloudKind, SegmentsKind };
+
+  /// Construct an empty Geometry of the given kind
+  explicit Geometry(Kind kind);
+
+  /// Construct a Geometry of the given kind taking ownership of the coordinates
+  Geometry(Kind kind, std::vector<double> &&x, std::vector<double> &&y);
+
+  /// the kind of primitive the points describe
+  Kind kind() const noexcept;
+
+  /// the number of points
+  std::size_t size() const noexcept;
+
+  /// the abscissas of the points
+  const std::vector<double> &x() const noexcept;
+
+  /// the ordinates of the points
+  const std::vector<double> &y() const noexcept;
+
+  /// append a point
+  void add(double x, double y);
+
+  /// multiply every abscissa and ordinate by the given factors
+  void scale(double xFactor, double yFactor) noexcept;
+
+  /// equality comparison based on kind and coordinates
+  bool operator==(const Geometry &right) const noexcept;
+
+ private:
+
+  Kind m_kind;
+
+  std::vector<double> m_x;
+
+  std::vector<double> m_y;
+};
+
+/// inequality comparison for Geometry
+bool operator!=(const Geometry &left, const Geometry &right) noexcept;
+
+/*! Multiply each value in the range [first, last) by factor.
+
+  The loop has no dependencies between iterations so the compiler can
+  vectorize it.
+ */
+void scaleValues(double *first, double *last, double factor) noexcept;
+
+#endif
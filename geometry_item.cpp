@@ -0,0 +1,86 @@
+#include "geometry_item.hpp"
+
+#include <QPainter>
+#include <algorithm>
+
+GeometryItem::GeometryItem(const Geometry &geometry, double width, QGraphicsItem *parent)
+    : QGraphicsItem(parent), m_kind(geometry.kind()), m_width(width) {
+
+  if (m_kind == Geometry::SegmentsKind) {
+    m_lines.reserve(static_cast<int>(geometry.size() / 2));
+    for (std::size_t i = 0; i + 1 < geometry.size(); i += 2)
+      m_lines.append(QLineF(geometry.x()[i], geometry.y()[i], geometry.x()[i + 1], geometry.y()[i + 1]));
+  }
+
+  m_points.reserve(static_cast<int>(geometry.size()));
+  for (std::size_t i = 0; i < geometry.size(); ++i)
+    m_points.append(QPointF(geometry.x()[i], geometry.y()[i]));
+
+  /// Pad by half a pen, and a little for cosmetic pens, so nothing drawn is clipped
+  qreal pad = std::max(m_width / 2, 0.5);
+  m_bounds = m_points.boundingRect().adjusted(-pad, -pad, pad, pad);
+  if (m_kind == Geometry::SegmentsKind)
+    m_points.clear();
+}
+
+int GeometryItem::type() const {
+  return Type;
+}
+
+QRectF GeometryItem::boundingRect() const {
+  return m_bounds;
+}
+
+void GeometryItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *, QWidget *) {
+
+  if (m_kind == Geometry::PointCloudKind) {
+    painter->setPen(Qt::NoPen);
+    painter->setBrush(QBrush(Qt::black, Qt::SolidPattern));
+    qreal radius = m_width / 2;
+    for (const QPointF &point:m_points)
+      painter->drawEllipse(point, radius, radius);
+  } else {
+    painter->setPen(QPen(QBrush(Qt::black, Qt::SolidPattern), m_width));
+    if (m_kind == Geometry::PolylineKind)
+      painter->drawPolyline(m_points);
+    else
+      painter->drawLines(m_lines);
+  }
+}
+
+Geometry::Kind GeometryItem::kind() const noexcept {
+  return m_kind;
+}
+
+std::size_t GeometryItem::size() const noexcept {
+  if (m_kind == Geometry::SegmentsKind)
+    return static_cast<std::size_t>(m_lines.size());
+  else if (m_kind == Geometry::PolylineKind)
+    return m_points.size() > 1 ? static_cast<std::size_t>(m_points.size() - 1) : 0;
+  return static_cast<std::size_t>(m_points.size());
+}
+
+std::size_t GeometryItem::count(const QRectF &rect) const {
+
+  std::size_t inside = 0;
+  if (m_kind == Geometry::PointCloudKind) {
+    qreal radius = m_width / 2;
+    for (const QPointF &point:m_points) {
+      if (point.x() - radius >= rect.left() && point.x() + radius <= rect.right()
+          && point.y() - radius >= rect.top() && point.y() + radius <= rect.bottom())
+        inside++;
+    }
+  } else if (m_kind == Geometry::PolylineKind) {
+    for (int i = 0; i + 1 < m_points.size(); ++i) {
+      if (rect.contains(m_points[i]) && rect.contains(m_points[i + 1]))
+        inside++;
+    }
+  } else {
+    for (const QLineF &line:m_lines) {
+      if (rect.contains(line.p1()) && rect.contains(line.p2()))
+        inside++;
+    }
+  }
+
+  return inside;
+}
@@ -0,0 +1,63 @@
+/*! \file geometry_item.hpp
+Defines the scene item drawing a Geometry in one pass.
+ */
+#ifndef PLOTSCRIPT_GEOMETRY_ITEM_HPP
+#define PLOTSCRIPT_GEOMETRY_ITEM_HPP
+
+#include <QGraphicsItem>
+#include <QPolygonF>
+#include <QVector>
+#include <QLineF>
+#include <cstddef>
+
+#include "geometry.hpp"
+
+/*! \class GeometryItem
+\brief Draws every primitive of a Geometry as a single scene item.
+
+A plot of many thousands of points or segments is one item rather than one
+per primitive, so adding it to a scene, indexing it and painting it cost a
+few calls instead of thousands. The coordinates are converted to Qt types
+once, when the item is made. Points are filled circles of the given width;
+lines are drawn with a pen of the given width, 0 being a cosmetic pen.
+ */
+class GeometryItem : public QGraphicsItem {
+ public:
+
+  /// the item type, distinct from the standard items
+  enum { Type = UserType + 1 };
+
+  /// Construct an item drawing geometry with the given point diameter or line thickness
+  GeometryItem(const Geometry &geometry, double width, QGraphicsItem *parent = nullptr);
+
+  int type() const override;
+
+  QRectF boundingRect() const override;
+
+  void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) override;
+
+  /// the kind of primitive drawn
+  Geometry::Kind kind() const noexcept;
+
+  /// the number of points or lines drawn
+  std::size_t size() const noexcept;
+
+  /// the number of points or lines drawn wholly inside rect
+  std::size_t count(const QRectF &rect) const;
+
+ private:
+
+  Geometry::Kind m_kind;
+
+  double m_width;
+
+  // the points of a polyline or point cloud
+  QPolygonF m_points;
+
+  // the lines of a set of segments
+  QVector<QLineF> m_lines;
+
+  QRectF m_bounds;
+};
+
+#endif //PLOTSCRIPT_GEOMETRY_ITEM_HPP
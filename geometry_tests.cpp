@@ -0,0 +1,70 @@
+#include "catch.hpp"
+
+#include <sstream>
+
+#include "geometry.hpp"
+#include "expression.hpp"
+
+TEST_CASE("Test geometry construction", "[geometry]") {
+
+  Geometry empty(Geometry::PolylineKind);
+  REQUIRE(empty.kind() == Geometry::PolylineKind);
+  REQUIRE(empty.size() == 0);
+
+  Geometry points(Geometry::PointCloudKind, {1, 2, 3}, {4, 5, 6});
+  REQUIRE(points.kind() == Geometry::PointCloudKind);
+  REQUIRE(points.size() == 3);
+  REQUIRE(points.x()[1] == 2);
+  REQUIRE(points.y()[2] == 6);
+
+  points.add(7, 8);
+  REQUIRE(points.size() == 4);
+  REQUIRE(points.x().back() == 7);
+  REQUIRE(points.y().back() == 8);
+}
+
+TEST_CASE("Test geometry scaling and comparison", "[geometry]") {
+
+  Geometry line(Geometry::PolylineKind, {1, -2}, {3, 4});
+  line.scale(2, -1);
+  REQUIRE(line == Geometry(Geometry::PolylineKind, {2, -4}, {-3, -4}));
+  REQUIRE(line != Geometry(Geometry::SegmentsKind, {2, -4}, {-3, -4}));
+  REQUIRE(line != Geometry(Geometry::PolylineKind, {2, -4}, {-3, 4}));
+
+  double max, min;
+  std::vector<double> values = {3, -1, 4, 1, -5, 9};
+  double factor = scaleFactor(values, max, min);
+  REQUIRE(factor == Approx(20. / 14));
+  REQUIRE(max == Approx(9 * factor));
+  REQUIRE(min == Approx(-5 * factor));
+}
+
+TEST_CASE("Test geometry expressions", "[geometry]") {
+
+  auto curve = std::make_shared<const Geometry>(Geometry::PolylineKind, std::vector<double>{0, 1},
+                                                std::vector<double>{2, 3});
+  Expression polyline(curve, 1);
+  REQUIRE(polyline.isPolyline());
+  REQUIRE(!polyline.isPointCloud());
+  REQUIRE(!polyline.isLine());
+  REQUIRE(polyline.getProperty("thickness") == Expression(1.));
+  REQUIRE(polyline.getProperty("object-name") == Expression("polyline", true));
+  REQUIRE(polyline.getGeometry() == curve.get());
+
+  Expression copy(polyline);
+  REQUIRE(copy == polyline);
+  REQUIRE(copy.getGeometry() == curve.get());
+
+  std::ostringstream out;
+  out << polyline;
+  REQUIRE(out.str() == "(((0) (2)) ((1) (3)))");
+
+  Expression cloud(std::make_shared<const Geometry>(Geometry::PointCloudKind), .5);
+  REQUIRE(cloud.isPointCloud());
+  REQUIRE(cloud.getProperty("size") == Expression(.5));
+  REQUIRE(cloud != polyline);
+
+  Expression segments(std::make_shared<const Geometry>(Geometry::SegmentsKind), 0);
+  REQUIRE(segments.isLineSegments());
+  REQUIRE(segments.getProperty("object-name") == Expression("line-segments", true));
+}
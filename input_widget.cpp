@@ -10,6 +10,14 @@
 #include <QDebug>
 #include <thread>
 
+namespace {
+
+bool isThreadingCommand(const Expression &result) {
+  return result.head().isString() && (result.head().asString() == "Threading Command");
+}
+
+}
+
 void InputWidget::keyPressEvent(QKeyEvent *event) {
 
   if ((event->key() == Qt::Key_Enter || event->key() == Qt::Key_Return) && event->modifiers() == Qt::ShiftModifier) {
@@ -19,59 +27,89 @@ void InputWidget::keyPressEvent(QKeyEvent *event) {
     if (line == "%exit")
       exit(EXIT_SUCCESS);
     else if (line == "%reset") {
-      Expression temp;
-      if (th1.joinable()) {
-        in.push("%stop");
-        out.wait_and_pop(temp);
-        th1.join();
-      }
-      std::thread th2(&Consumer::run, worker);
-      std::swap(th1, th2);
+      resetInterpreter();
+    } else if (line == "%stop") {
+      stopInterpreter();
     } else if (!th1.joinable() && (line == "%start")) {
-      std::thread th2(&Consumer::run, worker);
-      std::swap(th1, th2);
+      startInterpreter();
     } else if (th1.joinable() && (line != "%start")) {
-      in.push(line);
-      setReadOnly(true);
-      Expression result;
-      out.wait_and_pop(result);
-      setReadOnly(false);
-      if (result.head().isString() && (result.head().asString() == "Threading Command") && th1.joinable()) {
-        th1.join();
-      } else if (result.head().isError()) {
-        emit exceptionThrown(result.head().asError());
-      } else {
-        emit sendResult(result);
-      }//else
-      //timer.start(40);
+      Expression rejected = worker->submit(line);
+      if (rejected.head().isError()) {
+        fail(rejected.head().asError());
+        return;
+      }
+      setPending(pending + 1);
     } else if (!th1.joinable()) {
-      emit exceptionThrown("Error: interpreter kernel not running");
+      fail("Error: interpreter kernel not running");
     }
   } else {
     QPlainTextEdit::keyPressEvent(event);
   }
 }
 
+bool InputWidget::isBusy() const {
+  return pending != 0;
+}
+
 void InputWidget::popResult() {
 
-  Expression result;
-  if (out.try_pop(result)) {
-    setReadOnly(false);
-    timer.stop();
-    if (result.head().isString() && (result.head().asString() == "Threading Command") && th1.joinable()) {
-      th1.join();
-    } else if (result.head().isError()) {
-      emit exceptionThrown(result.head().asError());
-    } else {
-      emit sendResult(result);
-    }
+  Answer answer;
+  while (out.try_pop(answer)) {
+    deliver(answer);
   }
 }
 
+void InputWidget::deliver(const Answer &answer) {
+
+  const Expression &result = answer.result;
+
+  // acknowledgements of %reset and %stop carry no result
+  if (isThreadingCommand(result)) {
+    if (commands > 0)
+      commands--;
+    return;
+  }
+
+  // a partial result is shown until the result replaces it
+  if (answer.partial) {
+    emit sendResult(result);
+    return;
+  }
+
+  if (pending > 0)
+    setPending(pending - 1);
+
+  if (result.head().isError()) {
+    emit exceptionThrown(result.head().asError());
+  } else {
+    emit sendResult(result);
+  }
+  emit evaluationFinished();
+}
+
+void InputWidget::fail(const std::string &error) {
+
+  emit exceptionThrown(error);
+  emit evaluationFinished();
+}
+
+void InputWidget::setPending(std::size_t count) {
+
+  bool wasBusy = isBusy();
+  pending = count;
+  if (wasBusy != isBusy())
+    emit busyChanged(isBusy());
+}
+
 void InputWidget::init() {
-  connect(&timer, &QTimer::timeout, this, &InputWidget::popResult);
 
-  worker = new Consumer(&in, &out, id);
+  worker = new Consumer(&in, &out, id, &interrupted);
+  worker->setStreaming(std::chrono::milliseconds(STREAM_INTERVAL));
+
+  /// Called on the kernel thread, the queued call runs popResult on this one
+  worker->setNotify([this]() {
+    QMetaObject::invokeMethod(this, "popResult", Qt::QueuedConnection);
+  });
 
   std::thread th2(&Consumer::run, worker);
 
@@ -87,26 +125,46 @@ void InputWidget::startInterpreter() {
 
 void InputWidget::stopInterpreter() {
   if (th1.joinable()) {
-    Expression temp;
+    /// Drop the submissions and commands not yet started and interrupt the
+    /// running submission; a dropped command is never acknowledged
+    std::string dropped;
+    while (in.try_pop(dropped)) {
+      if (dropped == "%reset")
+        commands--;
+      else if (pending > 0)
+        setPending(pending - 1);
+    }
+    interrupted = true;
     in.push("%stop");
-    out.wait_and_pop(temp);
+    commands++;
+
+    /// The kernel answers in order, so the acknowledgement of the stop is
+    /// the last one outstanding, after any of a %reset already started
+    Answer temp;
+    while (commands > 0) {
+      out.wait_and_pop(temp);
+      deliver(temp);
+    }
     th1.join();
+    setPending(0);
   }
 }
 
 void InputWidget::resetInterpreter() {
-  Expression temp;
   if (th1.joinable()) {
-    in.push("%stop");
-    out.wait_and_pop(temp);
-    th1.join();
+    /// Evaluated after the submissions already queued, acknowledged through popResult
+    Expression rejected = worker->submit("%reset");
+    if (rejected.head().isError())
+      fail(rejected.head().asError());
+    else
+      commands++;
+  } else {
+    startInterpreter();
   }
-  std::thread th2(&Consumer::run, worker);
-  std::swap(th1, th2);
 }
 
 void InputWidget::interruptInterpreter() {
-  ;
+  interrupted = true;
 }
 
 InputWidget::~InputWidget() {
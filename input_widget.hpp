@@ -7,10 +7,15 @@
 #include <QPlainTextEdit>
 #include "expression.hpp"
 #include "Consumer.hpp"
+#include <atomic>
 #include <string>
 #include <thread>
-#include <QtCore/QTimer>
 
+// Submits programs to an interpreter thread without waiting for them. The
+// kernel wakes the widget with a queued call to popResult when it replies,
+// so the GUI thread never blocks on an evaluation and further programs can
+// be submitted while one runs; they are evaluated in order. A long plot is
+// shown as it is sampled, each partial result replaced by the next.
 class InputWidget : public QPlainTextEdit {
  Q_OBJECT
  public:
@@ -21,11 +26,23 @@ class InputWidget : public QPlainTextEdit {
 
   void keyPressEvent(QKeyEvent *event) override;
 
+  // true while submitted programs have not been answered
+  bool isBusy() const;
+
+  // milliseconds between the partial results of a long plot
+  static const int STREAM_INTERVAL = 50;
+
  signals:
 
   void exceptionThrown(const std::string &exception);
   void sendResult(const Expression &result);
 
+  // emitted when the kernel starts or stops having work
+  void busyChanged(bool busy);
+
+  // emitted after each submission is answered, with a result or an error
+  void evaluationFinished();
+
  public slots:
 
   void popResult();
@@ -36,12 +53,27 @@ class InputWidget : public QPlainTextEdit {
 
  private:
   std::size_t id = 1;
-  MessageQueue<std::string> in;
-  MessageQueue<Expression> out;
+  IncomingMail in{KERNEL_MAILBOX_CAPACITY, OverflowPolicy::Reject};
+  OutgoingMail out{KERNEL_MAILBOX_CAPACITY, OverflowPolicy::Block};
   Consumer *worker;
+  std::atomic<bool> interrupted{false};
   std::thread th1;
 
-  QTimer timer;
+  // submissions sent to the kernel and not yet answered
+  std::size_t pending = 0;
+
+  // threading commands sent to the kernel and not yet acknowledged, which
+  // are not submissions and are not counted in pending
+  std::size_t commands = 0;
+
+  // show a reply of the kernel
+  void deliver(const Answer &answer);
+
+  // report an error that did not come from the kernel
+  void fail(const std::string &error);
+
+  // set the number of unanswered submissions, signalling a change of state
+  void setPending(std::size_t count);
 };
 
 #endif //PLOTSCRIPT_INPUT_WIDGET_HPP
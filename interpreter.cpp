@@ -1,27 +1,125 @@
 #include "interpreter.hpp"
+#include "build_id.hpp"
 #include "startup_config.hpp"
 
 // system includes
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <stdexcept>
 #include <fstream>
+#include <sstream>
+
+#include <unistd.h>
 
 // module includes
 #include "token.hpp"
 #include "parse.hpp"
 #include "expression.hpp"
 #include "environment.hpp"
+#include "data_file.hpp"
 #include "semantic_error.hpp"
 
-std::stringstream startUp;
+namespace {
+
+// identifies an environment image and the layout of its header; the
+// header then holds the BUILD_ID of the interpreter that wrote the image,
+// so one built from other sources, with other builtins or another
+// encoding, never loads it
+const char IMAGE_MAGIC[8] = {'P', 'L', 'O', 'T', 'I', 'M', 'G', '2'};
+
+// 64 bit FNV-1a hash of the startup source
+std::uint64_t hashText(const std::string &text) {
+  std::uint64_t hash = 14695981039346656037ULL;
+  for (char c:text) {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+// define what the image holds if this build made it from a startup source with this hash
+bool loadStartUpImage(std::uint64_t hash, Environment &env) {
+  try {
+    MappedFile image(STARTUP_IMAGE);
+    const char *first = image.data();
+    const char *last = first + image.size();
+    std::uint64_t stored;
+    if (image.size() < sizeof(IMAGE_MAGIC) + sizeof(BUILD_ID) + sizeof(stored)
+        || std::memcmp(first, IMAGE_MAGIC, sizeof(IMAGE_MAGIC)) != 0
+        || std::memcmp(first + sizeof(IMAGE_MAGIC), BUILD_ID, sizeof(BUILD_ID)) != 0)
+      return false;
+    first += sizeof(IMAGE_MAGIC) + sizeof(BUILD_ID);
+    std::memcpy(&stored, first, sizeof(stored));
+    return stored == hash && env.loadImage(first + sizeof(stored), last);
+  } catch (const SemanticError &) {
+    return false;
+  }
+}
+
+// write the image through a temporary file so readers never see part of one
+void saveStartUpImage(std::uint64_t hash, const Environment &env) {
+  std::string image(IMAGE_MAGIC, sizeof(IMAGE_MAGIC));
+  image.append(BUILD_ID, sizeof(BUILD_ID));
+  image.append(reinterpret_cast<const char *>(&hash), sizeof(hash));
+  env.saveImage(image);
 
-void readStartUpFile() {
-  if (startUp.str().empty()) {
-    std::ifstream ifs(STARTUP_FILE);
-    if (ifs) {
-      startUp << ifs.rdbuf();
-      ifs.close();
+  // mkstemp makes a name no other thread or process is writing to
+  std::string temporary = STARTUP_IMAGE + ".XXXXXX";
+  int fd = mkstemp(&temporary[0]);
+  if (fd < 0)
+    return;
+  const char *data = image.data();
+  std::size_t left = image.size();
+  while (left > 0) {
+    ssize_t written = write(fd, data, left);
+    if (written < 0 && errno == EINTR)
+      continue;
+    if (written <= 0)
+      break;
+    data += written;
+    left -= static_cast<std::size_t>(written);
+  }
+  bool complete = close(fd) == 0 && left == 0;
+  if (!complete || std::rename(temporary.c_str(), STARTUP_IMAGE.c_str()) != 0)
+    std::remove(temporary.c_str());
+}
+
+// evaluate the startup file, or load the image of its last evaluation
+Environment makeStartUpEnvironment() {
+
+  std::stringstream source;
+  std::ifstream ifs(STARTUP_FILE);
+  if (ifs)
+    source << ifs.rdbuf();
+  // streaming an empty file sets failbit, which tokenize never checks
+  source.clear();
+
+  Environment env;
+  std::uint64_t hash = hashText(source.str());
+  if (!loadStartUpImage(hash, env)) {
+    TokenSequenceType tokens = tokenize(source);
+    Expression program = parse(tokens);
+    if (program != Expression()) {
+      program.eval(env);
+      saveStartUpImage(hash, env);
     }
   }
+
+  /// Everything defined from here on is dropped by reset
+  env.snapshot();
+  return env;
+}
+
+// the environment every interpreter starts as a copy of, sharing its
+// definitions; built once, by the first thread to ask for it
+const Environment &startUpEnvironment() {
+  static const Environment base = makeStartUpEnvironment();
+  return base;
+}
+
 }
 
 bool Interpreter::parseStream(std::istream &expression) noexcept {
@@ -35,15 +133,39 @@ bool Interpreter::parseStream(std::istream &expression) noexcept {
 
 Expression Interpreter::evaluate() {
 
+  env.setBudget(&budget);
+  env.setProgress(progress.report ? &progress : nullptr);
+  budget.start();
   return ast.eval(env);
 }
-Interpreter::Interpreter() {
+Interpreter::Interpreter() : env(startUpEnvironment()) {}
+
+void Interpreter::setInterrupt(const std::atomic<bool> *flag) noexcept {
+
+  env.setInterrupt(flag);
+}
+
+void Interpreter::setLimits(const Limits &limits) noexcept {
+
+  budget.setLimits(limits);
+}
 
-  readStartUpFile();
+void Interpreter::setProgress(const Progress &progress) {
+
+  this->progress = progress;
+}
+
+const Usage &Interpreter::usage() const noexcept {
+
+  return budget.usage();
+}
+
+Usage Interpreter::peakUsage() const noexcept {
+
+  return budget.peak();
+}
 
-  parseStream(startUp);
-  evaluate();
+void Interpreter::reset() {
 
-  startUp.clear();
-  startUp.seekg(0);
+  env.restore();
 }
@@ -8,17 +8,22 @@ It maintains an environment during evaluation.
 #define INTERPRETER_HPP
 
 // system includes
+#include <atomic>
 #include <istream>
 #include <string>
 
 // module includes
+#include "budget.hpp"
 #include "environment.hpp"
 #include "expression.hpp"
 
 /*! \class Interpreter
 \brief Class to parse and evaluate an expression (program)
 
-Interpreter has an Environment, which starts at a default.
+Interpreter has an Environment, which starts as a copy of the environment
+the startup file produced. That environment is built once per process and
+shared read-only by every interpreter, each holding only its own definitions,
+so interpreters may be created concurrently on any thread.
 The parse method builds an internal AST.
 The eval method updates Environment and returns last result.
 */
@@ -38,6 +43,38 @@ class Interpreter {
    */
   Expression evaluate();
 
+  /*! Set the flag that interrupts evaluate, which then throws Interrupted.
+    The interpreter stays usable and keeps the definitions made before the
+    interruption.
+    \param flag the flag, owned by the caller, or nullptr for none
+   */
+  void setInterrupt(const std::atomic<bool> *flag) noexcept;
+
+  /*! Set the limits on the resources each call to evaluate may use.
+    An evaluation exceeding one throws LimitExceeded, and the interpreter
+    stays usable.
+    \param limits the limits, 0 for none
+   */
+  void setLimits(const Limits &limits) noexcept;
+
+  /*! Set the functions that receive partial results during evaluate, such
+    as the plot of a continuous-plot before its sampling is complete. They
+    are called on the thread calling evaluate.
+    \param progress the functions, or an empty report function for none
+   */
+  void setProgress(const Progress &progress);
+
+  /// the resources used by the last call to evaluate
+  const Usage &usage() const noexcept;
+
+  /// the most of each resource any call to evaluate has used
+  Usage peakUsage() const noexcept;
+
+  /*! Drop every definition made since the startup file was evaluated.
+    Takes constant time, the startup file is not evaluated again.
+   */
+  void reset();
+
  private:
 
   // the environment
@@ -45,6 +82,12 @@ class Interpreter {
 
   // the AST
   Expression ast;
+
+  // counts the resources used by evaluate
+  Budget budget;
+
+  // receives partial results of evaluate
+  Progress progress;
 };
 
 #endif
@@ -1,9 +1,14 @@
 #include "catch.hpp"
 
+#include <chrono>
 #include <string>
 #include <sstream>
 #include <fstream>
 #include <iostream>
+#include <cstdio>
+#include <cmath>
+#include <thread>
+#include <vector>
 
 #include "semantic_error.hpp"
 #include "interpreter.hpp"
@@ -494,6 +499,43 @@ TEST_CASE("Test Interpreter result with simple procedures (rest)", "[interpreter
     exp.getTail().emplace_back(Expression(3));
     REQUIRE(result == exp);
   }
+
+  // rest keeps elements equal to the first and ends in the empty list
+  REQUIRE(run("(rest (list 1 1 2))") == run("(list 1 2)"));
+  REQUIRE(run("(rest (list 1))") == run("(list)"));
+  REQUIRE(run("(rest (rest (range 0 3 1)))") == run("(list 2 3)"));
+  REQUIRE(run("(first (rest (rest (list 1 2 3))))") == Expression(3));
+}
+
+TEST_CASE("Test Interpreter result with simple procedures (nth and slice)", "[interpreter]") {
+
+  REQUIRE(run("(nth (list 1 2 3) 0)") == Expression(1));
+  REQUIRE(run("(nth (rest (list 1 2 3)) 1)") == Expression(3));
+  REQUIRE(run("(nth (range 0 10 2) 3)") == Expression(6));
+  REQUIRE(run("(slice (list 1 2 3 4) 1 3)") == run("(list 2 3)"));
+  REQUIRE(run("(slice (list 1 2 3 4) 2 2)") == run("(list)"));
+  REQUIRE(run("(slice (range 0 10 1) 8 11)") == run("(list 8 9 10)"));
+  REQUIRE(run("(length (slice (list 1 2 3 4) 0 4))") == Expression(4));
+
+  std::vector<std::string> programs = {"(nth (list 1 2 3))",
+                                       "(nth 1 0)",
+                                       "(nth (list 1 2 3) 3)",
+                                       "(nth (list 1 2 3) -1)",
+                                       "(nth (list 1 2 3) 0.5)",
+                                       "(slice (list 1 2 3) 1)",
+                                       "(slice 1 0 1)",
+                                       "(slice (list 1 2 3) 2 1)",
+                                       "(slice (list 1 2 3) 0 4)"};
+  for (auto s : programs) {
+    Interpreter interp;
+
+    std::istringstream iss(s);
+
+    bool ok = interp.parseStream(iss);
+    REQUIRE(ok);
+
+    REQUIRE_THROWS_AS(interp.evaluate(), SemanticError);
+  }
 }
 
 TEST_CASE("Test Interpreter result with simple procedures (length)", "[interpreter]") {
@@ -569,6 +611,50 @@ TEST_CASE("Test Interpreter result with simple procedures (join)", "[interpreter
   exp.getTail().emplace_back(Expression(6));
   exp.getTail().emplace_back(Expression(std::complex<double>(2, 1)));
   REQUIRE(result == exp);
+
+  // appending to a list shared with earlier lists leaves them unchanged
+  program = "(begin (define a (list 1 2)) (define b (append a 3)) (define c (append a 4)) "
+            "(define d (join b a b)) (list a b c d))";
+  INFO(program);
+  REQUIRE(run(program) == run("(list (list 1 2) (list 1 2 3) (list 1 2 4) (list 1 2 3 1 2 1 2 3))"));
+}
+
+TEST_CASE("Test appending to and joining shared lists share their storage", "[interpreter]") {
+
+  /// every list built by append stays defined, so each append is to a shared list
+  auto appends = [](std::size_t count) {
+    std::string program = "(begin (define l0 (list 0))";
+    for (std::size_t i = 1; i <= count; ++i)
+      program += " (define l" + std::to_string(i) + " (append l" + std::to_string(i - 1) + " " + std::to_string(i) + "))";
+    program += " l" + std::to_string(count) + ")";
+    return program;
+  };
+  auto seconds = [](const std::string &program) {
+    double best = 0;
+    for (int attempt = 0; attempt < 3; ++attempt) {
+      auto start = std::chrono::steady_clock::now();
+      Expression result = run(program);
+      double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      best = attempt == 0 || elapsed < best ? elapsed : best;
+    }
+    return best;
+  };
+
+  REQUIRE(run(appends(100)) == run("(range 0 100 1)"));
+
+  /// four times the appends take about four times as long, where copying
+  /// the list on each append took sixteen
+  double small = seconds(appends(1000));
+  double large = seconds(appends(4000));
+  INFO(small << " s for 1000 appends, " << large << " s for 4000");
+  REQUIRE(large < 8 * small);
+
+  /// doubling a list twenty times shares the nodes of each copy
+  std::string program = "(begin (define l0 (range 0 9 1))";
+  for (int i = 1; i <= 20; ++i)
+    program += " (define l" + std::to_string(i) + " (join l" + std::to_string(i - 1) + " l" + std::to_string(i - 1) + "))";
+  program += " (list (length l20) (nth l20 0) (nth l20 123457) (nth l20 10485759)))";
+  REQUIRE(run(program) == run("(list 10485760 0 7 9)"));
 }
 
 TEST_CASE("Test Interpreter result with simple procedures (range)", "[interpreter]") {
@@ -584,6 +670,12 @@ TEST_CASE("Test Interpreter result with simple procedures (range)", "[interprete
   exp.getTail().emplace_back(Expression(5));
   exp.getTail().emplace_back(Expression(6));
   REQUIRE(result == exp);
+
+  // lazy ranges end at the last value within stop and fuse with map
+  REQUIRE(run("(length (range 0 100 0.01))") == Expression(10001.));
+  REQUIRE(run("(map - (range 1 3 1))") == run("(list -1 -2 -3)"));
+  REQUIRE(run("(begin (define f (lambda (x) (list x (* x x)))) (map f (range 0 2 1)))")
+              == run("(list (list 0 0) (list 1 1) (list 2 4))"));
 }
 
 TEST_CASE("Test Interpreter special forms: begin and define and list", "[interpreter]") {
@@ -1137,6 +1229,18 @@ TEST_CASE("Test empty argument to rest", "[interpreter]") {
   REQUIRE_THROWS_AS(interp.evaluate(), SemanticError);
 }
 
+TEST_CASE("Test non-list argument to rest", "[interpreter]") {
+
+  std::vector<std::string> programs = {"(rest \"abc\")", "(rest 1)", "(rest (+ 1 I))"};
+  for (auto &program:programs) {
+    INFO(program);
+    Interpreter interp;
+    std::istringstream iss(program);
+    REQUIRE(interp.parseStream(iss));
+    REQUIRE_THROWS_WITH(interp.evaluate(), "Error: argument to rest is not a list");
+  }
+}
+
 TEST_CASE("Test multiple argument to range", "[interpreter]") {
   std::string input = R"(
 (range 0 1 2 3)
@@ -1416,6 +1520,17 @@ TEST_CASE("Test Setting a property", "[interpreter]") {
     Expression result = run(program);
     REQUIRE(result == Expression("three", true));
   }
+  {
+    // a defined target is left unchanged, a temporary is updated in place
+    std::string program = "(begin (define p (list 1 2)) "
+                          "(define q (set-property \"size\" 2 (set-property \"name\" \"q\" p))) "
+                          "(list (get-property \"size\" p) (get-property \"size\" q) (get-property \"name\" q)))";
+    INFO(program);
+    Expression result = run(program);
+    REQUIRE(result.getTail()[0] == Expression());
+    REQUIRE(result.getTail()[1] == Expression(2.));
+    REQUIRE(result.getTail()[2] == Expression("q", true));
+  }
   {
     std::string input = R"(
 (set-property (+ 1 2) "number" "three")
@@ -1573,6 +1688,31 @@ TEST_CASE("Test make-text", "[interpreter]") {
   }
 }
 
+TEST_CASE("Test graphic constructors are builtins", "[interpreter]") {
+  {
+    std::string program = "(make-point (+ 1 I) 2)";
+    INFO(program);
+    Expression result = run(program);
+    REQUIRE(result.isPoint());
+    REQUIRE(result.getTail()[0] == Expression(std::complex<double>(1, 1)));
+  }
+
+  std::vector<std::string> programs = {"(make-point 1)",
+                                       "(make-line (make-point 0 0))",
+                                       "(make-text \"a\" \"b\")",
+                                       "(define make-point 1)"};
+  for (auto s : programs) {
+    Interpreter interp;
+
+    std::istringstream iss(s);
+
+    bool ok = interp.parseStream(iss);
+    REQUIRE(ok);
+
+    REQUIRE_THROWS_AS(interp.evaluate(), SemanticError);
+  }
+}
+
 /// Discrete Plot
 
 TEST_CASE("Test descrete-plot", "[interpreter]") {
@@ -1582,7 +1722,7 @@ TEST_CASE("Test descrete-plot", "[interpreter]") {
     INFO(program);
     Expression result = run(program);
 
-    REQUIRE(result.getTail().size() == 31);
+    REQUIRE(result.getTail().size() == 15);
   }
   {
     std::string program =
@@ -1590,7 +1730,7 @@ TEST_CASE("Test descrete-plot", "[interpreter]") {
     INFO(program);
     Expression result = run(program);
 
-    REQUIRE(result.getTail().size() == 29);
+    REQUIRE(result.getTail().size() == 13);
   }
   {
     std::string program =
@@ -1598,7 +1738,149 @@ TEST_CASE("Test descrete-plot", "[interpreter]") {
     INFO(program);
     Expression result = run(program);
 
-    REQUIRE(result.getTail().size() == 29);
+    REQUIRE(result.getTail().size() == 13);
+  }
+}
+
+TEST_CASE("Test descrete-plot decimation", "[interpreter]") {
+  {
+    std::string program =
+        "(begin (define f (lambda (x) (list x (sin (/ x 10))))) (discrete-plot (map f (range 0 5000 1)) (list (list \"resolution\" 100))))";
+    INFO(program);
+    Expression result = run(program);
+
+    Expression cloud;
+    for (auto &item:result.getTail())
+      if (item.isPointCloud())
+        cloud = item;
+    REQUIRE(cloud.getGeometry()->size() <= 200);
+    REQUIRE(cloud.getProperty("decimation-input") == Expression(5001.));
+    REQUIRE(cloud.getProperty("decimation-output") == Expression(double(cloud.getGeometry()->size())));
+    REQUIRE(cloud.getProperty("decimation-columns") == Expression(100.));
+  }
+  {
+    std::string program =
+        "(begin (define f (lambda (x) (list x (+ (* 2 x) 1)))) (discrete-plot (map f (range -2 2 0.5))))";
+    INFO(program);
+    Expression result = run(program);
+
+    for (auto &item:result.getTail())
+      if (item.isPointCloud())
+        REQUIRE(item.getProperty("decimation-input") == Expression());
+  }
+}
+
+TEST_CASE("Test read-csv", "[interpreter]") {
+  {
+    std::ofstream out("read_csv_test.csv");
+    out << "t,value\n0,1.5\n1,-2\n2,4\n";
+  }
+  {
+    std::string program = "(read-csv \"read_csv_test.csv\")";
+    INFO(program);
+    Expression result = run(program);
+
+    REQUIRE(result.getTail().size() == 2);
+    REQUIRE(result.getTail()[1] == run("(list 1.5 -2 4)"));
+  }
+  {
+    std::string program = "(read-csv \"read_csv_test.csv\" (list 1) 2)";
+    INFO(program);
+    Expression result = run(program);
+
+    REQUIRE(result == run("(list (list 1.5 -2))"));
+  }
+  {
+    std::string program = "(discrete-plot (first (rest (read-csv \"read_csv_test.csv\"))))";
+    INFO(program);
+    Expression result = run(program);
+
+    for (auto &item:result.getTail())
+      if (item.isPointCloud())
+        REQUIRE(item.getGeometry()->size() == 3);
+  }
+  std::remove("read_csv_test.csv");
+
+  std::vector<std::string> programs = {"(read-csv)",
+                                       "(read-csv 1)",
+                                       "(read-csv \"read_csv_test.csv\")",
+                                       "(read-csv \"read_csv_test.csv\" 1)",
+                                       "(read-csv \"read_csv_test.csv\" (list -1))"};
+  for (auto s : programs) {
+    Interpreter interp;
+
+    std::istringstream iss(s);
+
+    bool ok = interp.parseStream(iss);
+    REQUIRE(ok);
+
+    REQUIRE_THROWS_AS(interp.evaluate(), SemanticError);
+  }
+}
+
+TEST_CASE("Test read-binary and read-npy", "[interpreter]") {
+  {
+    std::vector<double> values = {1.5, -2, 4};
+    std::ofstream out("read_binary_test.bin", std::ios::binary);
+    out.write(reinterpret_cast<const char *>(values.data()), values.size() * sizeof(double));
+  }
+  {
+    std::string program = "(read-binary \"read_binary_test.bin\")";
+    INFO(program);
+    Expression result = run(program);
+
+    REQUIRE(result.isList());
+    REQUIRE(result.getSequence() != nullptr);
+    REQUIRE(result == run("(list 1.5 -2 4)"));
+  }
+  {
+    std::string program = "(length (read-binary \"read_binary_test.bin\"))";
+    INFO(program);
+    REQUIRE(run(program) == Expression(3.));
+  }
+  {
+    std::string program = "(first (read-binary \"read_binary_test.bin\"))";
+    INFO(program);
+    REQUIRE(run(program) == Expression(1.5));
+  }
+  {
+    std::string program = "(map - (read-binary \"read_binary_test.bin\"))";
+    INFO(program);
+    REQUIRE(run(program) == run("(list -1.5 2 -4)"));
+  }
+  {
+    std::string program = "(discrete-plot (read-binary \"read_binary_test.bin\"))";
+    INFO(program);
+    Expression result = run(program);
+
+    for (auto &item:result.getTail())
+      if (item.isPointCloud())
+        REQUIRE(item.getGeometry()->size() == 3);
+  }
+  {
+    /// A series read lazily is scaled before it is simplified, as a list is
+    std::string options = "(list (list \"simplify-tolerance\" 100))";
+    Expression lazy = run("(discrete-plot (read-binary \"read_binary_test.bin\") " + options + ")");
+    Expression list = run("(discrete-plot (list 1.5 -2 4) " + options + ")");
+    REQUIRE(lazy == list);
+  }
+  std::remove("read_binary_test.bin");
+
+  std::vector<std::string> programs = {"(read-binary)",
+                                       "(read-binary 1)",
+                                       "(read-binary \"read_binary_test.bin\")",
+                                       "(read-binary \"read_binary_test.bin\" 8)",
+                                       "(read-npy)",
+                                       "(read-npy \"read_binary_test.npy\")"};
+  for (auto s : programs) {
+    Interpreter interp;
+
+    std::istringstream iss(s);
+
+    bool ok = interp.parseStream(iss);
+    REQUIRE(ok);
+
+    REQUIRE_THROWS_AS(interp.evaluate(), SemanticError);
   }
 }
 
@@ -1616,13 +1898,119 @@ TEST_CASE("Test continuous-plot", "[interpreter]") {
         "        (list \"text-scale\" .1))))";
     INFO(program);
     Expression result = run(program);
-    REQUIRE(result.getTail().size() == 63);
+    REQUIRE(result.getTail().size() == 14);
   }
   {
     std::string program = "(begin (define f (lambda (x) (sin x))) (continuous-plot f (list (- pi) pi)))";
     INFO(program);
     Expression result = run(program);
-    REQUIRE(result.getTail().size() == 82);
+    REQUIRE(result.getTail().size() == 11);
+  }
+  {
+    /// a sample budget must convert to a positive count
+    std::vector<std::string> budgets = {"0", "-5", "(/ 0 0)", "(/ 1 0)", "1e30", "\"ten\""};
+    for (auto &budget:budgets) {
+      std::string program = "(begin (define f (lambda (x) (sin x))) "
+                            "(continuous-plot f (list 0 1) (list (list \"sample-budget\" " + budget + "))))";
+      INFO(program);
+      Interpreter interp;
+      std::istringstream iss(program);
+      REQUIRE(interp.parseStream(iss));
+      REQUIRE_THROWS_WITH(interp.evaluate(), "Error: sample-budget to continuous-plot not a positive number");
+    }
+  }
+}
+
+TEST_CASE("Test continuous-plot partial results", "[interpreter]") {
+
+  Interpreter interp;
+  std::size_t asked = 0;
+  std::size_t reported = 0;
+  bool wanted = false;
+  Progress progress;
+  progress.wanted = [&asked, &wanted]() {
+    asked++;
+    return wanted;
+  };
+  progress.report = [&reported](const Expression &partial) {
+    REQUIRE(partial.getTail().size() == 11);
+    reported++;
+  };
+  interp.setProgress(progress);
+
+  std::string program = "(begin (define f (lambda (x) (sin x))) (continuous-plot f (list (- pi) pi)))";
+
+  /// no partial plot is built while none is wanted
+  std::istringstream iss(program);
+  REQUIRE(interp.parseStream(iss));
+  REQUIRE(interp.evaluate().getTail().size() == 11);
+  REQUIRE(asked > 0);
+  REQUIRE(reported == 0);
+
+  wanted = true;
+  asked = 0;
+  std::istringstream again("(continuous-plot f (list (- pi) pi))");
+  REQUIRE(interp.parseStream(again));
+  interp.evaluate();
+  REQUIRE(reported > 0);
+  REQUIRE(reported == asked);
+}
+
+
+TEST_CASE("Test interpreters created on many threads", "[interpreter]") {
+
+  std::vector<Expression> results(8);
+  std::vector<std::thread> threads;
+  for (std::size_t i = 0; i < results.size(); ++i) {
+    threads.emplace_back([&results, i]() {
+      Interpreter interp;
+      std::istringstream define("(define a (append (list 1 2) " + std::to_string(i) + "))");
+      interp.parseStream(define);
+      interp.evaluate();
+      std::istringstream lookup("(begin (define b (+ (nth a 2) pi)) b)");
+      interp.parseStream(lookup);
+      results[i] = interp.evaluate();
+    });
   }
+  for (auto &thread:threads)
+    thread.join();
+
+  /// each interpreter sees only its own definitions
+  for (std::size_t i = 0; i < results.size(); ++i)
+    REQUIRE(results[i] == Expression(i + std::atan2(0, -1)));
 }
 
+TEST_CASE("Test resource limits", "[interpreter]") {
+
+  Interpreter interp;
+  auto evaluate = [&interp](const std::string &program) {
+    std::istringstream iss(program);
+    REQUIRE(interp.parseStream(iss));
+    return interp.evaluate();
+  };
+
+  /// runaway recursion stops at the default depth limit
+  evaluate("(define f (lambda (x) (f x)))");
+  REQUIRE_THROWS_WITH(evaluate("(f 1)"), "Error: evaluation exceeded its depth limit");
+  REQUIRE(interp.usage().depth == Limits().depth + 1);
+
+  Limits limits;
+  limits.steps = 1000;
+  limits.nodes = 100;
+  interp.setLimits(limits);
+  REQUIRE(evaluate("(+ 1 2)") == Expression(3.));
+  REQUIRE(interp.usage().steps == 3);
+
+  REQUIRE_THROWS_WITH(evaluate("(join (range 0 60 1) (range 0 60 1))"), "Error: evaluation exceeded its node limit");
+  REQUIRE_THROWS_WITH(evaluate("(map f (range 0 10 1))"), "Error: evaluation exceeded its step limit");
+
+  limits = Limits();
+  limits.bytes = 10 * sizeof(Expression);
+  interp.setLimits(limits);
+  REQUIRE_THROWS_WITH(evaluate("(list 1 2 3 4 5 6 7 8 9 10 11)"), "Error: evaluation exceeded its memory limit");
+
+  /// the interpreter stays usable and remembers the largest use
+  REQUIRE(evaluate("(+ 1 2)") == Expression(3.));
+  REQUIRE(interp.peakUsage().depth > Limits().depth);
+  REQUIRE(interp.peakUsage().nodes >= 100);
+}
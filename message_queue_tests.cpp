@@ -0,0 +1,66 @@
+#include "catch.hpp"
+
+#include <string>
+#include <thread>
+
+#include "MessageQueue.hpp"
+
+TEST_CASE("Test unbounded message queue", "[message queue]") {
+
+  MessageQueue<int> queue;
+  for (int i = 0; i < 100; ++i)
+    REQUIRE(queue.push(i));
+
+  int value;
+  REQUIRE(queue.try_pop(value));
+  REQUIRE(value == 0);
+
+  QueueStats stats = queue.stats();
+  REQUIRE(stats.size == 99);
+  REQUIRE(stats.highWater == 100);
+  REQUIRE(stats.pushed == 100);
+}
+
+TEST_CASE("Test message queue overflow policies", "[message queue]") {
+
+  int value;
+
+  {
+    INFO("Reject leaves the queue unchanged");
+    MessageQueue<int> queue(2, OverflowPolicy::Reject);
+    REQUIRE(queue.push(1));
+    REQUIRE(queue.push(2));
+    REQUIRE_FALSE(queue.push(3));
+    REQUIRE(queue.stats().rejected == 1);
+    queue.wait_and_pop(value);
+    REQUIRE(value == 1);
+    REQUIRE(queue.push(3));
+    REQUIRE(queue.stats().highWater == 2);
+  }
+
+  {
+    INFO("DropOldest discards the front");
+    MessageQueue<int> queue(2, OverflowPolicy::DropOldest);
+    REQUIRE(queue.push(1));
+    REQUIRE(queue.push(2));
+    REQUIRE(queue.push(3));
+    REQUIRE(queue.stats().dropped == 1);
+    queue.wait_and_pop(value);
+    REQUIRE(value == 2);
+  }
+
+  {
+    INFO("Block waits for a pop");
+    MessageQueue<int> queue(1, OverflowPolicy::Block);
+    REQUIRE(queue.push(1));
+    std::thread producer([&queue]() { queue.push(2); });
+    while (queue.stats().blocked == 0)
+      std::this_thread::yield();
+    queue.wait_and_pop(value);
+    REQUIRE(value == 1);
+    queue.wait_and_pop(value);
+    REQUIRE(value == 2);
+    producer.join();
+    REQUIRE(queue.stats().highWater == 1);
+  }
+}
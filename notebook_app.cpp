@@ -21,11 +21,16 @@ NotebookApp::NotebookApp() {
   interruptBtn->setObjectName("interrupt");
   interruptBtn->setText("Interrupt");
 
+  status = new QLabel();
+  status->setObjectName("status");
+  status->setText("Kernel idle");
+
   auto btnLayout = new QHBoxLayout();
   btnLayout->addWidget(startBtn);
   btnLayout->addWidget(stopBtn);
   btnLayout->addWidget(resetBtn);
   btnLayout->addWidget(interruptBtn);
+  btnLayout->addWidget(status);
 
   input = new InputWidget();
   input->setObjectName("input");
@@ -36,6 +41,9 @@ NotebookApp::NotebookApp() {
 
   connect(input, &InputWidget::exceptionThrown, output, &OutputWidget::printText);
   connect(input, &InputWidget::sendResult, output, &OutputWidget::outputExpression);
+  connect(input, &InputWidget::busyChanged, status, [this](bool busy) {
+    status->setText(busy ? "Kernel busy" : "Kernel idle");
+  });
 
   /// Button Signals
   connect(startBtn, &QPushButton::released, input, &InputWidget::startInterpreter);
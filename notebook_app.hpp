@@ -7,6 +7,7 @@
 #include <QWidget>
 #include <QVBoxLayout>
 #include <QtWidgets/QPushButton>
+#include <QtWidgets/QLabel>
 
 #include "input_widget.hpp"
 #include "output_widget.hpp"
@@ -24,6 +25,8 @@ class NotebookApp : public QWidget {
   QPushButton *stopBtn;
   QPushButton *resetBtn;
   QPushButton *interruptBtn;
+
+  QLabel *status;
 };
 
 #endif //PLOTSCRIPT_NOTEBOOK_APP_HPP
@@ -1,9 +1,29 @@
 #include <QTest>
+#include <QSignalSpy>
 #include <QtWidgets/QGraphicsTextItem>
 #include "notebook_app.hpp"
+#include "geometry_item.hpp"
 #include <QDebug>
+#include <QApplication>
+#include <QImage>
+#include <QPainter>
+#include <QResizeEvent>
+#include <cmath>
+#include <memory>
 
 /// Helper Functions
+
+/*
+submit - press Shift+Enter in the input and wait for the result to be delivered
+ */
+bool submit(InputWidget *input) {
+
+  QSignalSpy finished(input, &InputWidget::evaluationFinished);
+  QTest::keyClick(input, Qt::Key_Return, Qt::ShiftModifier);
+
+  return finished.count() > 0 || finished.wait(10000);
+}
+
 int findLines(QGraphicsScene *scene, QRectF bbox, qreal margin) {
 
   QPainterPath selectPath;
@@ -19,6 +39,15 @@ int findLines(QGraphicsScene *scene, QRectF bbox, qreal margin) {
       }
     }
 
+  /// lines drawn in a batch are counted one by one
+      foreach(auto item, scene->items(bbox.marginsAdded(margins), Qt::IntersectsItemBoundingRect)) {
+      if (item->type() == GeometryItem::Type) {
+        auto batch = static_cast<GeometryItem *>(item);
+        if (batch->kind() != Geometry::PointCloudKind)
+          numlines += batch->count(bbox.marginsAdded(margins));
+      }
+    }
+
   return numlines;
 }
 
@@ -38,6 +67,15 @@ int findPoints(QGraphicsScene *scene, QPointF center, qreal radius) {
       }
     }
 
+  /// points drawn in a batch are counted one by one
+      foreach(auto item, scene->items(selectPath.boundingRect(), Qt::IntersectsItemBoundingRect)) {
+      if (item->type() == GeometryItem::Type) {
+        auto batch = static_cast<GeometryItem *>(item);
+        if (batch->kind() == Geometry::PointCloudKind)
+          numpoints += batch->count(selectPath.boundingRect());
+      }
+    }
+
   return numpoints;
 }
 
@@ -100,6 +138,16 @@ class NotebookTest : public QObject {
   void testContinuousSinPlot();
   void testStart_StopButton();
   void testResetButton();
+  void testStopAfterReset();
+  void testQueuedSubmissions();
+  void testBatchedPrimitives();
+  void testIncrementalUpdate();
+  void testStreamedPlot();
+  void testRasterizedPlot();
+  void testResizeDebounce();
+  void benchmarkCurve();
+  void benchmarkPrimitives();
+  void benchmarkUnchanged();
 
  private:
   InputWidget *input;
@@ -112,6 +160,7 @@ class NotebookTest : public QObject {
   QPushButton *stop;
   QPushButton *reset;
   QPushButton *interrupt;
+  QLabel *status;
 };
 
 void NotebookTest::initTestCase() {
@@ -126,6 +175,7 @@ void NotebookTest::initTestCase() {
   stop = notebook->findChild<QPushButton *>("stop");
   reset = notebook->findChild<QPushButton *>("reset");
   interrupt = notebook->findChild<QPushButton *>("interrupt");
+  status = notebook->findChild<QLabel *>("status");
 }
 
 void NotebookTest::objectNames() {
@@ -138,6 +188,8 @@ void NotebookTest::objectNames() {
   QVERIFY2(stop, "Could not find stop button");
   QVERIFY2(reset, "Could not find reset button");
   QVERIFY2(interrupt, "Could not find interrupt button");
+
+  QVERIFY2(status, "Could not find kernel status");
 }
 
 void NotebookTest::testTextOutput() {
@@ -147,8 +199,7 @@ void NotebookTest::testTextOutput() {
 
   QVERIFY2(input->toPlainText() == QString::fromStdString(inputText), "Text not set");
 
-  QKeyEvent *event = new QKeyEvent(QEvent::KeyPress, Qt::Key_Enter, Qt::ShiftModifier);
-  input->keyPressEvent(event);
+  QVERIFY2(submit(input), "No result was delivered");
 
   auto graphicsObjects = scene->items();
 
@@ -164,8 +215,7 @@ void NotebookTest::testBasicPoint() {
   std::string inputText = "(set-property \"size\" 200 (make-point 1 2))";
   input->setPlainText(QString::fromStdString(inputText));
 
-  QKeyEvent *event = new QKeyEvent(QEvent::KeyPress, Qt::Key_Enter, Qt::ShiftModifier);
-  input->keyPressEvent(event);
+  QVERIFY2(submit(input), "No result was delivered");
 
   auto graphicsObjects = scene->items();
 
@@ -180,8 +230,7 @@ void NotebookTest::testBasicLine() {
   std::string inputText = "(set-property \"thickness\" 2 (make-line (make-point 0 2) (make-point 2 0)))";
   input->setPlainText(QString::fromStdString(inputText));
 
-  QKeyEvent *event = new QKeyEvent(QEvent::KeyPress, Qt::Key_Enter, Qt::ShiftModifier);
-  input->keyPressEvent(event);
+  QVERIFY2(submit(input), "No result was delivered");
 
   auto graphicsObjects = scene->items();
 
@@ -196,8 +245,7 @@ void NotebookTest::testBasicText() {
   std::string inputText = "(set-property \"position\" (make-point 2 4) (make-text \"Hello World\" ) )";
   input->setPlainText(QString::fromStdString(inputText));
 
-  QKeyEvent *event = new QKeyEvent(QEvent::KeyPress, Qt::Key_Enter, Qt::ShiftModifier);
-  input->keyPressEvent(event);
+  QVERIFY2(submit(input), "No result was delivered");
 
   auto graphicsObjects = scene->items();
 
@@ -214,8 +262,7 @@ void NotebookTest::testDefaultLine() {
   std::string inputText = "(make-line (make-point 0 0) (make-point 3 2))";
   input->setPlainText(QString::fromStdString(inputText));
 
-  QKeyEvent *event = new QKeyEvent(QEvent::KeyPress, Qt::Key_Enter, Qt::ShiftModifier);
-  input->keyPressEvent(event);
+  QVERIFY2(submit(input), "No result was delivered");
 
   auto graphicsObjects = scene->items();
 
@@ -237,7 +284,7 @@ void NotebookTest::testDiscretePlotLayout() {
 )";
 
   input->setPlainText(QString::fromStdString(program));
-  QTest::keyClick(input, Qt::Key_Return, Qt::ShiftModifier);
+  QVERIFY2(submit(input), "No result was delivered");
 
   auto view = output->findChild<QGraphicsView *>();
   QVERIFY2(view, "Could not find QGraphicsView as child of OutputWidget");
@@ -322,7 +369,7 @@ void NotebookTest::testContinuousPlotLayout() {
         (list "ordinate-label" "y"))))
 )";
   input->setPlainText(QString::fromStdString(program));
-  QTest::keyClick(input, Qt::Key_Return, Qt::ShiftModifier);
+  QVERIFY2(submit(input), "No result was delivered");
 
   auto view = output->findChild<QGraphicsView *>();
   QVERIFY2(view, "Could not find QGraphicsView as child of OutputWidget");
@@ -330,7 +377,8 @@ void NotebookTest::testContinuousPlotLayout() {
   auto scene = view->scene();
 
   auto items = scene->items();
-  QCOMPARE(items.size(), 63);
+  /// the curve is one item
+  QCOMPARE(items.size(), 14);
 
 }
 
@@ -339,7 +387,7 @@ void NotebookTest::testContinuousSinPlot() {
 (begin (define f (lambda (x) (sin x))) (continuous-plot f (list (- pi) pi)))
 )";
   input->setPlainText(QString::fromStdString(program));
-  QTest::keyClick(input, Qt::Key_Return, Qt::ShiftModifier);
+  QVERIFY2(submit(input), "No result was delivered");
 
   auto view = output->findChild<QGraphicsView *>();
   QVERIFY2(view, "Could not find QGraphicsView as child of OutputWidget");
@@ -355,7 +403,7 @@ void NotebookTest::testStart_StopButton() {
 
   std::string program = R"( (* 2 3) )";
   input->setPlainText(QString::fromStdString(program));
-  QTest::keyClick(input, Qt::Key_Return, Qt::ShiftModifier);
+  QVERIFY2(submit(input), "No result was delivered");
   auto graphicsObjects = scene->items();
   auto *result = (QGraphicsTextItem *) *graphicsObjects.cbegin();
   QVERIFY2(result->toPlainText() == QString("(6)"), "(* 2 3) did not evaluate to (6)");
@@ -363,7 +411,7 @@ void NotebookTest::testStart_StopButton() {
   stop->click();
 
   input->setPlainText(QString::fromStdString(program));
-  QTest::keyClick(input, Qt::Key_Return, Qt::ShiftModifier);
+  QVERIFY2(submit(input), "No result was delivered");
   auto graphicsObject = scene->items();
   auto *results = (QGraphicsTextItem *) *graphicsObject.cbegin();
   QVERIFY2(results->toPlainText() == QString("Error: interpreter kernel not running"), "Error was not thrown");
@@ -371,24 +419,41 @@ void NotebookTest::testStart_StopButton() {
   start->click();
 
   input->setPlainText(QString::fromStdString(program));
-  QTest::keyClick(input, Qt::Key_Return, Qt::ShiftModifier);
+  QVERIFY2(submit(input), "No result was delivered");
   auto graphics = scene->items();
   auto *answer = (QGraphicsTextItem *) *graphics.cbegin();
   QVERIFY2(answer->toPlainText() == QString("(6)"), "(* 2 3) did not evaluate to (6)");
 
+  /// Typed commands stop and start the kernel like the buttons
+  input->setPlainText(QString::fromStdString("%stop"));
+  QTest::keyClick(input, Qt::Key_Return, Qt::ShiftModifier);
+  QVERIFY2(!input->isBusy(), "%stop was counted as a submission");
+
+  input->setPlainText(QString::fromStdString(program));
+  QVERIFY2(submit(input), "No result was delivered");
+  auto stopped = (QGraphicsTextItem *) *scene->items().cbegin();
+  QVERIFY2(stopped->toPlainText() == QString("Error: interpreter kernel not running"), "%stop did not stop the kernel");
+
+  input->setPlainText(QString::fromStdString("%start"));
+  QTest::keyClick(input, Qt::Key_Return, Qt::ShiftModifier);
+
+  input->setPlainText(QString::fromStdString(program));
+  QVERIFY2(submit(input), "No result was delivered");
+  auto started = (QGraphicsTextItem *) *scene->items().cbegin();
+  QVERIFY2(started->toPlainText() == QString("(6)"), "%start did not start the kernel");
 }
 
 void NotebookTest::testResetButton() {
 
   std::string program = R"( (define a 1) )";
   input->setPlainText(QString::fromStdString(program));
-  QTest::keyClick(input, Qt::Key_Return, Qt::ShiftModifier);
+  QVERIFY2(submit(input), "No result was delivered");
   auto graphicsObjects = scene->items();
   auto *result = (QGraphicsTextItem *) *graphicsObjects.cbegin();
   QVERIFY2(result->toPlainText() == QString("(1)"), "a was not defined");
 
   input->setPlainText(QString::fromStdString(program));
-  QTest::keyClick(input, Qt::Key_Return, Qt::ShiftModifier);
+  QVERIFY2(submit(input), "No result was delivered");
   auto graphicsObject = scene->items();
   auto *results = (QGraphicsTextItem *) *graphicsObject.cbegin();
   QVERIFY2(results->toPlainText() != QString("(1)"), "a was defined");
@@ -396,13 +461,276 @@ void NotebookTest::testResetButton() {
   reset->click();
 
   input->setPlainText(QString::fromStdString(program));
-  QTest::keyClick(input, Qt::Key_Return, Qt::ShiftModifier);
+  QVERIFY2(submit(input), "No result was delivered");
   auto graphics = scene->items();
   auto *answer = (QGraphicsTextItem *) *graphics.cbegin();
   QVERIFY2(answer->toPlainText() == QString("(1)"), "a was not redefined");
 
 }
 
+void NotebookTest::testStopAfterReset() {
+
+  std::string program = R"( (* 2 3) )";
+
+  /// A queued %reset is dropped by the stop without being counted as a submission
+  input->setPlainText(QString::fromStdString("(begin (define f (lambda (x) (length (range 0 x 1)))) (length (map f (range 0 400 1))))"));
+  QTest::keyClick(input, Qt::Key_Return, Qt::ShiftModifier);
+  reset->click();
+  input->setPlainText(QString::fromStdString(program));
+  QTest::keyClick(input, Qt::Key_Return, Qt::ShiftModifier);
+  stop->click();
+  QVERIFY2(!input->isBusy(), "The stop left submissions counted");
+
+  /// The acknowledgement of a %reset does not end the wait for the stop
+  start->click();
+  reset->click();
+  stop->click();
+  QVERIFY2(!input->isBusy(), "The stop left submissions counted");
+
+  start->click();
+  input->setPlainText(QString::fromStdString(program));
+  QVERIFY2(submit(input), "No result was delivered");
+  auto *answer = (QGraphicsTextItem *) *scene->items().cbegin();
+  QVERIFY2(answer->toPlainText() == QString("(6)"), "(* 2 3) did not evaluate to (6)");
+  QVERIFY2(!input->isBusy(), "Kernel was still busy");
+}
+
+void NotebookTest::testQueuedSubmissions() {
+
+  QSignalSpy finished(input, &InputWidget::evaluationFinished);
+  QSignalSpy busy(input, &InputWidget::busyChanged);
+
+  /// The first submission keeps the kernel busy while the second is typed
+  input->setPlainText(QString::fromStdString("(begin (define f (lambda (x) (length (range 0 x 1)))) (length (map f (range 0 400 1))))"));
+  QTest::keyClick(input, Qt::Key_Return, Qt::ShiftModifier);
+  QVERIFY2(!input->isReadOnly(), "Input was blocked during an evaluation");
+  QVERIFY2(input->isBusy(), "Kernel was not busy");
+  QVERIFY2(status->text() == QString("Kernel busy"), "Status did not show the kernel busy");
+
+  input->setPlainText(QString::fromStdString("(* 2 3)"));
+  QTest::keyClick(input, Qt::Key_Return, Qt::ShiftModifier);
+
+  while (finished.count() < 2 && finished.wait(10000)) {}
+  QCOMPARE(finished.count(), 2);
+  QVERIFY2(!input->isBusy(), "Kernel was still busy");
+  QVERIFY2(status->text() == QString("Kernel idle"), "Status did not show the kernel idle");
+  QCOMPARE(busy.count(), 2);
+
+  /// Results are delivered in the order submitted
+  auto graphicsObjects = scene->items();
+  auto *result = (QGraphicsTextItem *) *graphicsObjects.cbegin();
+  QVERIFY2(result->toPlainText() == QString("(6)"), "(* 2 3) was not delivered last");
+}
+
+void NotebookTest::testBatchedPrimitives() {
+
+  /// A long list of points is drawn as one item, a short one point by point
+  std::string program = R"( (begin (define f (lambda (x) (set-property "size" 1 (make-point x 0)))) (map f (range 0 99 1))) )";
+  input->setPlainText(QString::fromStdString(program));
+  QVERIFY2(submit(input), "No result was delivered");
+
+  QCOMPARE(scene->items().size(), 1);
+  QCOMPARE(scene->items().first()->type(), int(GeometryItem::Type));
+  QCOMPARE(findPoints(scene, QPointF(50, 0), 0.6), 1);
+  QCOMPARE(findPoints(scene, QPointF(50, 0), 100), 100);
+
+  program = R"( (begin (define f (lambda (x) (set-property "size" 1 (make-point x 0)))) (map f (range 0 9 1))) )";
+  input->setPlainText(QString::fromStdString(program));
+  QVERIFY2(submit(input), "No result was delivered");
+
+  QCOMPARE(scene->items().size(), 10);
+  QCOMPARE(findPoints(scene, QPointF(5, 0), 0.6), 1);
+}
+
+void NotebookTest::testIncrementalUpdate() {
+
+  std::string program = R"(
+(discrete-plot (list (list -1 -1) (list 1 1)) (list (list "title" "First") (list "abscissa-label" "X Label")))
+)";
+  input->setPlainText(QString::fromStdString(program));
+  QVERIFY2(submit(input), "No result was delivered");
+  QList<QGraphicsItem *> before = scene->items();
+
+  /// Changing the title draws only the title again
+  program = R"(
+(discrete-plot (list (list -1 -1) (list 1 1)) (list (list "title" "Second") (list "abscissa-label" "X Label")))
+)";
+  input->setPlainText(QString::fromStdString(program));
+  QVERIFY2(submit(input), "No result was delivered");
+  QList<QGraphicsItem *> after = scene->items();
+
+  QCOMPARE(after.size(), before.size());
+  int kept = 0;
+      foreach(auto item, after) {
+      if (before.contains(item))
+        kept += 1;
+    }
+  QCOMPARE(kept, before.size() - 1);
+
+  int titles = 0;
+      foreach(auto item, after) {
+      if (item->type() == QGraphicsTextItem::Type) {
+        QString text = static_cast<QGraphicsTextItem *>(item)->toPlainText();
+        QVERIFY2(text != QString("First"), "The old title was kept");
+        if (text == QString("Second"))
+          titles += 1;
+      }
+    }
+  QCOMPARE(titles, 1);
+
+  /// Items no longer drawn leave the scene
+  program = R"( (* 2 3) )";
+  input->setPlainText(QString::fromStdString(program));
+  QVERIFY2(submit(input), "No result was delivered");
+  QCOMPARE(scene->items().size(), 1);
+}
+
+void NotebookTest::testStreamedPlot() {
+
+  /// A slow function, so the plot is shown before its sampling is complete
+  std::string program = R"(
+(begin
+    (define g (lambda (y) y))
+    (define f (lambda (x) (begin (length (map g (range 0 3000 1))) (sin x))))
+    (continuous-plot f (list -3 3) (list (list "sample-budget" 120))))
+)";
+
+  /// The result is shown once, so any earlier showing is a partial plot
+  int shown = 0;
+  auto count = QObject::connect(input, &InputWidget::sendResult, [&shown](const Expression &) { shown += 1; });
+  input->setPlainText(QString::fromStdString(program));
+  QVERIFY2(submit(input), "No result was delivered");
+  QObject::disconnect(count);
+  QVERIFY2(shown > 1, "The plot was not shown before it was complete");
+
+  /// The result replaces the partial plot
+  QCOMPARE(scene->items().size(), 14);
+}
+
+/*
+largeCurve - a polyline of the given number of segments
+ */
+Expression largeCurve(int segments) {
+
+  auto curve = std::make_shared<Geometry>(Geometry::PolylineKind);
+  for (int i = 0; i <= segments; ++i)
+    curve->add(i / 100., 10 * std::sin(i / 100.));
+  return Expression(std::shared_ptr<const Geometry>(curve), 0);
+}
+
+void NotebookTest::testRasterizedPlot() {
+
+  /// A large result is shown as one image, drawn off the GUI thread
+  QSignalSpy drawn(output, &OutputWidget::rasterized);
+  output->outputExpression(largeCurve(50000));
+  QVERIFY2(drawn.count() > 0 || drawn.wait(10000), "No image was drawn");
+  QTRY_COMPARE(scene->items().size(), 1);
+  QCOMPARE(scene->items().first()->type(), int(QGraphicsPixmapItem::Type));
+
+  QImage image = qvariant_cast<QImage>(drawn.last().first());
+  QCOMPARE(image.size(), view->viewport()->size() * view->devicePixelRatioF());
+
+  /// A small result replaces it with the scene
+  std::string program = R"( (* 2 3) )";
+  input->setPlainText(QString::fromStdString(program));
+  QVERIFY2(submit(input), "No result was delivered");
+  auto *result = (QGraphicsTextItem *) *scene->items().cbegin();
+  QVERIFY2(result->toPlainText() == QString("(6)"), "(* 2 3) did not evaluate to (6)");
+}
+
+void NotebookTest::testResizeDebounce() {
+
+  QSignalSpy drawn(output, &OutputWidget::rasterized);
+  output->outputExpression(largeCurve(50000));
+  QTRY_COMPARE(drawn.count(), 1);
+
+  /// Resizing many times draws the image again once
+  for (int width = 300; width < 400; width += 10) {
+    QResizeEvent resize(QSize(width, 300), QSize(width - 10, 300));
+    QApplication::sendEvent(output, &resize);
+  }
+  QTRY_COMPARE(drawn.count(), 2);
+  QTest::qWait(2 * OutputWidget::RESIZE_DELAY);
+  QCOMPARE(drawn.count(), 2);
+}
+
+/*
+render - draw the view into an image, as painting it on screen would
+ */
+void render(QGraphicsView *view) {
+
+  QImage image(400, 400, QImage::Format_ARGB32_Premultiplied);
+  image.fill(Qt::white);
+  QPainter painter(&image);
+  view->render(&painter);
+}
+
+/*
+shownResult - submit a program and return the result shown, NONE if there was none
+ */
+Expression shownResult(InputWidget *input, const std::string &program) {
+
+  input->setPlainText(QString::fromStdString(program));
+  Expression result;
+  auto keep = QObject::connect(input, &InputWidget::sendResult, [&result](const Expression &shown) {
+    result = shown;
+  });
+  submit(input);
+  QObject::disconnect(keep);
+  return result;
+}
+
+// 10000 lines made one by one with make-line
+const std::string LINES_PROGRAM = R"(
+(begin (define f (lambda (x) (make-line (make-point x 0) (make-point x (sin x))))) (map f (range 0 9999 1)))
+)";
+
+void NotebookTest::benchmarkCurve() {
+
+  /// A 10000 segment curve, as continuous-plot makes, below the size rasterized
+  Expression result = largeCurve(10000);
+
+  /// Showing something else first, or the scene keeps the curve and there is nothing to build
+  QBENCHMARK {
+    output->outputExpression(Expression());
+    output->outputExpression(result);
+    render(view);
+  }
+
+  QCOMPARE(scene->items().size(), 1);
+}
+
+void NotebookTest::benchmarkPrimitives() {
+
+  Expression result = shownResult(input, LINES_PROGRAM);
+  QVERIFY2(result.isList(), "No lines were made");
+
+  QBENCHMARK {
+    output->outputExpression(Expression());
+    output->outputExpression(result);
+    render(view);
+  }
+
+  QCOMPARE(scene->items().size(), 1);
+}
+
+void NotebookTest::benchmarkUnchanged() {
+
+  /// Showing a result again keeps every item, so only the keys are compared
+  Expression result = shownResult(input, LINES_PROGRAM);
+  QVERIFY2(result.isList(), "No lines were made");
+  output->outputExpression(result);
+  QGraphicsItem *shown = scene->items().first();
+
+  QBENCHMARK {
+    output->outputExpression(result);
+    render(view);
+  }
+
+  QCOMPARE(scene->items().size(), 1);
+  QVERIFY2(scene->items().first() == shown, "The unchanged lines were drawn again");
+}
+
 QTEST_MAIN(NotebookTest)
 #include "notebook_test.moc"
 
@@ -7,6 +7,34 @@
 #include <QString>
 #include <QtWidgets/QGraphicsTextItem>
 #include <QtGui/QResizeEvent>
+#include <QPixmap>
+
+#include "geometry_item.hpp"
+#include "raster.hpp"
+
+namespace {
+
+// runs of points or lines at least this long are drawn as one item
+const std::size_t BATCH_SIZE = 64;
+
+// most items of one type kept for reuse
+const std::size_t POOL_SIZE = 4096;
+
+// the diameter of a point, or the thickness of a line, if it is a number
+const Expression *styleOf(const Expression &item) {
+  const Expression *style = item.findProperty(item.isPoint() ? "size" : "thickness");
+  return (style != nullptr && style->isHeadNumber()) ? style : nullptr;
+}
+
+// whether next can join a run of primitives like first
+bool sameStyle(const Expression &first, const Expression &next) {
+  if (next.isPoint() != first.isPoint() || next.isLine() != first.isLine())
+    return false;
+  const Expression *style = styleOf(next);
+  return style != nullptr && style->head().asNumber() == styleOf(first)->head().asNumber();
+}
+
+}
 
 OutputWidget::OutputWidget() {
 
@@ -19,6 +47,27 @@ OutputWidget::OutputWidget() {
   layout->addWidget(view);
 
   setLayout(layout);
+
+  resizeTimer.setSingleShot(true);
+  resizeTimer.setInterval(RESIZE_DELAY);
+  connect(&resizeTimer, &QTimer::timeout, this, &OutputWidget::rasterizeAgain);
+
+  /// Images are drawn on their own thread and shown on this one
+  connect(this, &OutputWidget::rasterized, this, &OutputWidget::showRaster, Qt::QueuedConnection);
+  rasterThread = std::thread(&OutputWidget::rasterLoop, this);
+}
+
+OutputWidget::~OutputWidget() {
+
+  RasterJob stop;
+  stop.stop = true;
+  rasterJobs.push(stop);
+  rasterThread.join();
+
+  for (auto &free:pool) {
+    for (QGraphicsItem *item:free.second)
+      delete item;
+  }
 }
 void OutputWidget::printText(const std::string &text) {
 
@@ -28,69 +77,215 @@ void OutputWidget::printText(const std::string &text) {
     newText = "Error: Invalid Expression. Could not parse.";
   }
 
-  scene->clear();
-  QGraphicsTextItem *textItem = scene->addText(QString::fromStdString(newText));
+  clear();
+  QGraphicsTextItem *textItem = reuse<QGraphicsTextItem>(std::string());
+  textItem->setPlainText(QString::fromStdString(newText));
+  textItem->setCacheMode(QGraphicsItem::NoCache);
   textItem->setPos(0, 0);
-  view->fitInView(0, 0, scene->width(), scene->height(), Qt::KeepAspectRatio);
+  textItem->setScale(1);
+  textItem->setRotation(0);
+  retire();
+  fit();
 
 }
 void OutputWidget::outputExpression(const Expression &result) {
 
-  scene->clear();
+  if (countPrimitives(result) >= RASTER_SIZE) {
+    clear();
+    rastered = result;
+    isRastered = true;
+    requestRaster();
+    return;
+  }
+
+  /// An image is replaced, a scene is updated with what changed
+  if (isRastered)
+    clear();
+  quint64 drawing = ++generation;
+
+  bool shown;
   if (result.isList() && isGraphic(result) && !result.isLine()) {
-    for (auto &item:result.getTail()) {
-      if (!showExpression(item)) {
-        return;
+    shown = showList(result.getTail().cbegin(), result.getTail().cend());
+  } else {
+    shown = showExpression(result);
+  }
+
+  /// An invalid primitive has already replaced the scene with its error
+  if (generation != drawing)
+    return;
+
+  retire();
+  if (shown)
+    fit();
+}
+
+bool OutputWidget::keep(const std::string &key) {
+
+  auto found = retained.find(key);
+  if (found == retained.end())
+    return false;
+
+  current.insert(*found);
+  retained.erase(found);
+  return true;
+}
+
+template<typename Item>
+Item *OutputWidget::reuse(const std::string &key) {
+
+  auto &free = pool[Item::Type];
+  Item *item;
+  if (free.empty()) {
+    item = new Item();
+  } else {
+    item = static_cast<Item *>(free.back());
+    free.pop_back();
+  }
+
+  add(key, item);
+  return item;
+}
+
+void OutputWidget::add(const std::string &key, QGraphicsItem *item) {
+
+  scene->addItem(item);
+  current.emplace(key, item);
+}
+
+void OutputWidget::retire() {
+
+  for (auto &entry:retained) {
+    QGraphicsItem *item = entry.second;
+    scene->removeItem(item);
+    auto &free = pool[item->type()];
+    if (item->type() == GeometryItem::Type || free.size() >= POOL_SIZE)
+      delete item;
+    else
+      free.push_back(item);
+  }
+
+  retained.clear();
+  retained.swap(current);
+}
+
+bool OutputWidget::showList(Tail::const_iterator first, Tail::const_iterator last) {
+
+  while (first != last) {
+    Tail::const_iterator end = first + 1;
+    if ((first->isPoint() || first->isLine()) && styleOf(*first) != nullptr) {
+      while (end != last && sameStyle(*first, *end))
+        ++end;
+    }
+
+    if (static_cast<std::size_t>(end - first) < BATCH_SIZE) {
+      for (; first != end; ++first) {
+        if (!showExpression(*first))
+          return false;
       }
+      continue;
     }
-  } else {
-    showExpression(result);
+
+    std::string key("run");
+    for (auto item = first; item != end; ++item)
+      item->serialize(key);
+    if (keep(key)) {
+      first = end;
+      continue;
+    }
+
+    /// Pack the run into one Geometry, the points of a line being consecutive
+    Geometry run(first->isPoint() ? Geometry::PointCloudKind : Geometry::SegmentsKind);
+    for (auto item = first; item != end; ++item) {
+      if (item->isPoint()) {
+        run.add(item->getTail().cbegin()->head().asNumber(), (item->getTail().cbegin() + 1)->head().asNumber());
+      } else {
+        for (auto &point:item->getTail())
+          run.add(point.getTail().cbegin()->head().asNumber(), (point.getTail().cbegin() + 1)->head().asNumber());
+      }
+    }
+    auto batch = new GeometryItem(run, styleOf(*first)->head().asNumber());
+    batch->setCacheMode(QGraphicsItem::DeviceCoordinateCache);
+    add(key, batch);
+    first = end;
   }
 
+  return true;
 }
 bool OutputWidget::showExpression(const Expression &result) {
   if (result.isLambda())
     return false;
-  else if (result.isPoint()) {
-    if (result.getProperty("size").isHeadNumber()) {
-      double offset = result.getProperty("size").head().asNumber() / 2;
-      QGraphicsEllipseItem *point = scene->addEllipse((result.getTail().cbegin())->head().asNumber() - offset,
-                                                      (result.getTail().cbegin() + 1)->head().asNumber() - offset,
-                                                      result.getProperty("size").head().asNumber(),
-                                                      result.getProperty("size").head().asNumber(),
-                                                      QPen(Qt::NoPen),
-                                                      QBrush(Qt::black, Qt::SolidPattern));
-      point->setVisible(true);
+
+  /// A primitive drawn by the last result keeps its item
+  std::string key;
+  result.serialize(key);
+  if (keep(key))
+    return true;
+
+  if (result.getGeometry() != nullptr) {
+    const Geometry &geometry = *result.getGeometry();
+    if (geometry.kind() == Geometry::PointCloudKind) {
+      const Expression *size = result.findProperty("size");
+      if (size == nullptr || !size->isHeadNumber() || !(size->head().asNumber() > 0)) {
+        printText("Error: point-cloud size not a positive number");
+        return false;
+      }
+      auto points = new GeometryItem(geometry, size->head().asNumber());
+      points->setCacheMode(QGraphicsItem::DeviceCoordinateCache);
+      add(key, points);
+    } else {
+      const Expression *thickness = result.findProperty("thickness");
+      if (thickness == nullptr || !thickness->isHeadNumber()) {
+        printText("Error: polyline thickness not a number");
+        return false;
+      }
+      auto lines = new GeometryItem(geometry, thickness->head().asNumber());
+      lines->setCacheMode(QGraphicsItem::DeviceCoordinateCache);
+      add(key, lines);
+    }
+  } else if (result.isPoint()) {
+    const Expression *size = result.findProperty("size");
+    if (size != nullptr && size->isHeadNumber()) {
+      double offset = size->head().asNumber() / 2;
+      QGraphicsEllipseItem *point = reuse<QGraphicsEllipseItem>(key);
+      point->setRect((result.getTail().cbegin())->head().asNumber() - offset,
+                     (result.getTail().cbegin() + 1)->head().asNumber() - offset,
+                     size->head().asNumber(),
+                     size->head().asNumber());
+      point->setPen(QPen(Qt::NoPen));
+      point->setBrush(QBrush(Qt::black, Qt::SolidPattern));
     } else {
       printText("Error: make-point size not a positive number");
       return false;
     }
   } else if (result.isLine()) {
-    if (result.getProperty("thickness").isHeadNumber()) {
-      QGraphicsLineItem *line = scene->addLine((result.getTail().cbegin())->getTail().cbegin()->head().asNumber(),
-                                               (result.getTail().cbegin()->getTail().cbegin() + 1)->head().asNumber(),
-                                               ((result.getTail().cbegin() + 1)->getTail().cbegin())->head().asNumber(),
-                                               ((result.getTail().cbegin() + 1)->getTail().cbegin()
-                                                   + 1)->head().asNumber(),
-                                               QPen(QBrush(Qt::black, Qt::SolidPattern),
-                                                    result.getProperty("thickness").head().asNumber()));
-      line->setVisible(true);
+    const Expression *thickness = result.findProperty("thickness");
+    if (thickness != nullptr && thickness->isHeadNumber()) {
+      QGraphicsLineItem *line = reuse<QGraphicsLineItem>(key);
+      line->setLine((result.getTail().cbegin())->getTail().cbegin()->head().asNumber(),
+                    (result.getTail().cbegin()->getTail().cbegin() + 1)->head().asNumber(),
+                    ((result.getTail().cbegin() + 1)->getTail().cbegin())->head().asNumber(),
+                    ((result.getTail().cbegin() + 1)->getTail().cbegin() + 1)->head().asNumber());
+      line->setPen(QPen(QBrush(Qt::black, Qt::SolidPattern), thickness->head().asNumber()));
     } else {
       printText(("Error: make-line thickness not a number"));
       return false;
     }
   } else if (result.isText()) {
-    if (result.getProperty("position").isPoint()) {
-      QGraphicsTextItem *textItem = scene->addText(QString::fromStdString(result.head().asString()));
+    const Expression *position = result.findProperty("position");
+    if (position != nullptr && position->isPoint()) {
+      QGraphicsTextItem *textItem = reuse<QGraphicsTextItem>(key);
+      textItem->setPlainText(QString::fromStdString(result.head().asString()));
+      textItem->setCacheMode(QGraphicsItem::DeviceCoordinateCache);
       textItem->setPos(
-          result.getProperty("position").getTail().cbegin()->head().asNumber() - textItem->boundingRect().width() / 2,
-          (result.getProperty("position").getTail().cbegin() + 1)->head().asNumber()
+          position->getTail().cbegin()->head().asNumber() - textItem->boundingRect().width() / 2,
+          (position->getTail().cbegin() + 1)->head().asNumber()
               - textItem->boundingRect().height() / 2);
       textItem->setTransformOriginPoint(textItem->boundingRect().width() / 2, textItem->boundingRect().height() / 2);
-      if (result.getProperty("text-scale").isHeadNumber())
-        textItem->setScale(result.getProperty("text-scale").head().asNumber());
-      if (result.getProperty("text-rotation").isHeadNumber())
-        textItem->setRotation(result.getProperty("text-rotation").head().asNumber() * 180 / std::atan2(0, -1));
+      const Expression *scale = result.findProperty("text-scale");
+      textItem->setScale(scale != nullptr && scale->isHeadNumber() ? scale->head().asNumber() : 1);
+      const Expression *rotation = result.findProperty("text-rotation");
+      textItem->setRotation(rotation != nullptr && rotation->isHeadNumber()
+                            ? rotation->head().asNumber() * 180 / std::atan2(0, -1) : 0);
     } else {
       printText("Error: make-text position not a point");
       return false;
@@ -99,17 +294,20 @@ bool OutputWidget::showExpression(const Expression &result) {
   } else {
     std::stringstream iss;
     iss << result;
-    QGraphicsTextItem *textItem = scene->addText(QString::fromStdString(iss.str()));
+    QGraphicsTextItem *textItem = reuse<QGraphicsTextItem>(key);
+    textItem->setPlainText(QString::fromStdString(iss.str()));
+    textItem->setCacheMode(QGraphicsItem::NoCache);
     textItem->setPos(0, 0);
+    textItem->setScale(1);
+    textItem->setRotation(0);
   }
 
-  view->fitInView(0, 0, scene->width(), scene->height(), Qt::KeepAspectRatio);
   return true;
 }
 
 bool OutputWidget::isGraphic(const Expression &input) {
   for (auto &item:input.getTail()) {
-    if (item.isPoint() || item.isLine() || item.isText())
+    if (item.isPoint() || item.isLine() || item.isText() || item.getGeometry() != nullptr)
       return true;
   }
   return false;
@@ -118,6 +316,79 @@ bool OutputWidget::isGraphic(const Expression &input) {
 void OutputWidget::resizeEvent(QResizeEvent *event) {
   QWidget::resizeEvent(event);
 
+  if (isRastered) {
+    /// Stretch the image shown until the size settles
+    view->fitInView(view->sceneRect(), Qt::KeepAspectRatio);
+    resizeTimer.start();
+  } else {
+    fit();
+  }
+}
+
+void OutputWidget::clear() {
+
+  generation++;
+  resizeTimer.stop();
+  rastered = Expression();
+  isRastered = false;
+  scene->clear();
+  retained.clear();
+  current.clear();
+  view->setSceneRect(QRectF());
+}
+
+void OutputWidget::requestRaster() {
+
+  RasterJob job;
+  job.result = rastered;
+  job.size = view->viewport()->size();
+  job.ratio = view->devicePixelRatioF();
+  job.generation = ++generation;
+  rasterJobs.push(job);
+}
+
+void OutputWidget::rasterizeAgain() {
+
+  if (isRastered)
+    requestRaster();
+}
+
+void OutputWidget::rasterLoop() {
+
+  RasterJob job;
+  while (true) {
+    rasterJobs.wait_and_pop(job);
+
+    /// Only the latest request is drawn
+    bool stop = job.stop;
+    RasterJob next;
+    while (rasterJobs.try_pop(next)) {
+      stop = stop || next.stop;
+      job = next;
+    }
+    if (stop)
+      return;
+    if (job.generation != generation)
+      continue;
+
+    QImage image = rasterize(job.result, job.size, job.ratio);
+    if (job.generation == generation)
+      emit rasterized(image, job.generation);
+  }
+}
+
+void OutputWidget::showRaster(const QImage &image, quint64 generation) {
+
+  if (!isRastered || generation != this->generation)
+    return;
+
+  scene->clear();
+  QGraphicsPixmapItem *pixmap = scene->addPixmap(QPixmap::fromImage(image));
+  view->setSceneRect(pixmap->boundingRect());
+  view->resetTransform();
+}
+
+void OutputWidget::fit() {
   view->fitInView(0, 0, scene->width(), scene->height(), Qt::KeepAspectRatio);
 }
 
@@ -7,23 +7,118 @@
 #include <QGraphicsView>
 #include <QGraphicsScene>
 #include <QVBoxLayout>
+#include <QImage>
+#include <QTimer>
+#include <atomic>
+#include <map>
 #include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 #include "expression.hpp"
+#include "MessageQueue.hpp"
 
+// Shows results in a graphics scene. The scene is updated rather than
+// rebuilt: each item is keyed by the encoding of the primitive it draws, so
+// a primitive unchanged from the last result keeps its item and only the
+// primitives that changed are drawn, with items reused from a pool. A
+// polyline or point cloud, and a batched run of points or lines, is one item
+// under one key, so changing any of its points draws all of it again.
+//
+// A result drawing at least RASTER_SIZE
+// primitives is instead drawn into an image on a rasterizing thread at the
+// size of the view, and the image is shown; resizing redraws it once the
+// size has settled.
 class OutputWidget : public QWidget {
-
+ Q_OBJECT
  public:
   OutputWidget();
+  ~OutputWidget();
 
   void resizeEvent(QResizeEvent *event) override;
 
+  // results with at least this many primitives are rasterized
+  static const std::size_t RASTER_SIZE = 20000;
+
+  // milliseconds the size must be unchanged before a result is rasterized again
+  static const int RESIZE_DELAY = 150;
+
+ signals:
+
+  // emitted on the rasterizing thread when the image of a result is drawn
+  void rasterized(const QImage &image, quint64 generation);
+
+ private slots:
+
+  void showRaster(const QImage &image, quint64 generation);
+  void rasterizeAgain();
+
  private:
   QGraphicsScene *scene;
   QGraphicsView *view;
 
+  // an image to draw, or the request to stop the rasterizing thread
+  struct RasterJob {
+    Expression result;
+    QSize size;
+    qreal ratio = 1;
+    quint64 generation = 0;
+    bool stop = false;
+  };
+
+  MessageQueue<RasterJob> rasterJobs;
+  std::thread rasterThread;
+
+  // counts changes of what is shown, so stale images are dropped
+  std::atomic<quint64> generation{0};
+
+  // the result shown as an image, empty when the scene is shown
+  Expression rastered;
+  bool isRastered = false;
+
+  QTimer resizeTimer;
+
+  // empty the scene, forgetting any image still being drawn
+  void clear();
+
+  // ask the rasterizing thread for an image of the rastered result at the view size
+  void requestRaster();
+
+  // draw the latest requested images until told to stop
+  void rasterLoop();
+
   bool showExpression(const Expression &result);
   bool isGraphic(const Expression &input);
 
+  // show the graphics in [first, last) of a list, batching long runs of
+  // points of one size, or lines of one thickness, into a single item
+  bool showList(Tail::const_iterator first, Tail::const_iterator last);
+
+  // scale the view to the scene, once the scene is complete
+  void fit();
+
+  // the items of the last result, by the encoding of the primitive each draws
+  std::unordered_multimap<std::string, QGraphicsItem *> retained;
+
+  // the items of the result being shown, replacing retained when it is complete
+  std::unordered_multimap<std::string, QGraphicsItem *> current;
+
+  // items out of the scene kept for reuse, by item type
+  std::map<int, std::vector<QGraphicsItem *>> pool;
+
+  // keep the item drawing key in the last result, false if there is none
+  bool keep(const std::string &key);
+
+  // an item for key, from the pool if one is free, added to the scene
+  template<typename Item>
+  Item *reuse(const std::string &key);
+
+  // add an item drawing key to the scene
+  void add(const std::string &key, QGraphicsItem *item);
+
+  // move the items of the last result that were not kept to the pool
+  void retire();
+
  public slots:
   void printText(const std::string &text);
   void outputExpression(const Expression &result);
@@ -1,12 +1,18 @@
+#include <algorithm>
+#include <atomic>
+#include <csignal>
 #include <string>
 #include <sstream>
 #include <iostream>
 #include <fstream>
+#include <new>
 #include <thread>
+#include <vector>
 
 #include "interpreter.hpp"
 #include "semantic_error.hpp"
 #include "Consumer.hpp"
+#include "ConsumerPool.hpp"
 #include "MessageQueue.hpp"
 
 void prompt() {
@@ -44,6 +50,14 @@ int eval_from_stream(std::istream &stream) {
       std::cerr << ex.what() << std::endl;
       return EXIT_FAILURE;
     }
+    catch (const std::bad_alloc &) {
+      error("evaluation ran out of memory");
+      return EXIT_FAILURE;
+    }
+    catch (const std::exception &ex) {
+      error(ex.what());
+      return EXIT_FAILURE;
+    }
   }
 
   return EXIT_SUCCESS;
@@ -61,6 +75,57 @@ int eval_from_file(const std::string &filename) {
   return eval_from_stream(ifs);
 }
 
+// evaluate each file in an interpreter of its own on a pool of threads, so a
+// slow program does not hold up the rest, printing the results in order
+int eval_from_files(const std::vector<std::string> &filenames) {
+
+  IncomingMail in;
+  OutgoingMail out;
+
+  /// Each file is a session of its own, which tells its answer apart
+  std::vector<bool> opened(filenames.size(), false);
+  std::size_t submitted = 0;
+  for (std::size_t i = 0; i < filenames.size(); ++i) {
+    std::ifstream ifs(filenames[i]);
+    if (ifs) {
+      std::ostringstream program;
+      program << ifs.rdbuf();
+      in.push(program.str(), Priority::Batch, i + 1);
+      opened[i] = true;
+      submitted++;
+    }
+  }
+
+  std::size_t workers = std::min<std::size_t>(filenames.size(), std::max(std::thread::hardware_concurrency(), 1u));
+  ConsumerPool pool(&in, &out, workers);
+
+  std::vector<Expression> results(filenames.size());
+  for (std::size_t i = 0; i < submitted; ++i) {
+    Answer answer;
+    out.wait_and_pop(answer);
+    results[answer.session - 1] = answer.result;
+  }
+  pool.stop();
+
+  int status = EXIT_SUCCESS;
+  for (std::size_t i = 0; i < filenames.size(); ++i) {
+    if (!opened[i]) {
+      error("Could not open file for reading.");
+      status = EXIT_FAILURE;
+    } else if (results[i].head().isError() && results[i].head().asError() == "Invalid Expression. Could not parse.") {
+      error("Invalid Program. Could not parse.");
+      status = EXIT_FAILURE;
+    } else if (results[i].head().isError()) {
+      std::cerr << results[i] << std::endl;
+      status = EXIT_FAILURE;
+    } else {
+      std::cout << results[i] << std::endl;
+    }
+  }
+
+  return status;
+}
+
 int eval_from_command(const std::string &argexp) {
 
   std::istringstream expression(argexp);
@@ -68,13 +133,20 @@ int eval_from_command(const std::string &argexp) {
   return eval_from_stream(expression);
 }
 
+// set by Ctrl-C to interrupt the running evaluation
+std::atomic<bool> interrupted(false);
+
+void interrupt(int) {
+  interrupted = true;
+}
+
 // A REPL is a repeated read-eval-print loop
 void repl() {
 
   std::size_t id = 1;
-  MessageQueue<std::string> in;
-  MessageQueue<Expression> out;
-  Consumer worker(&in, &out, id);
+  IncomingMail in(KERNEL_MAILBOX_CAPACITY, OverflowPolicy::Reject);
+  OutgoingMail out(KERNEL_MAILBOX_CAPACITY, OverflowPolicy::Block);
+  Consumer worker(&in, &out, id, &interrupted);
 
   std::thread th1(&Consumer::run, worker);
 
@@ -86,7 +158,7 @@ void repl() {
       continue;
 
     if (line == "%exit") {
-      Expression temp;
+      Answer temp;
       if (th1.joinable()) {
         in.push("%stop");
         out.wait_and_pop(temp);
@@ -94,22 +166,32 @@ void repl() {
       }
       exit(EXIT_SUCCESS);
     } else if (line == "%reset") {
-      Expression temp;
+      Answer temp;
       if (th1.joinable()) {
-        in.push("%stop");
+        in.push("%reset");
         out.wait_and_pop(temp);
-        th1.join();
+      } else {
+        std::thread th2(&Consumer::run, worker);
+        std::swap(th1, th2);
       }
-      std::thread th2(&Consumer::run, worker);
-      std::swap(th1, th2);
     } else if (!th1.joinable() && (line == "%start")) {
       std::thread th2(&Consumer::run, worker);
       std::swap(th1, th2);
     } else if (th1.joinable() && (line != "%start")) {
-      in.push(line);
+      /// Ctrl-C interrupts the evaluation while it runs, and at the prompt
+      /// it keeps its default action of ending the program
+      auto previous = std::signal(SIGINT, interrupt);
+      Expression rejected = worker.submit(line);
+      if (rejected.head().isError()) {
+        std::signal(SIGINT, previous);
+        std::cerr << rejected << std::endl;
+        continue;
+      }
 
-      Expression result;
-      out.wait_and_pop(result);
+      Answer answer;
+      out.wait_and_pop(answer);
+      std::signal(SIGINT, previous);
+      const Expression &result = answer.result;
 
       if (result.head().isString() && (result.head().asString() == "Threading Command") && th1.joinable()) {
         th1.join();
@@ -122,7 +204,7 @@ void repl() {
     }
   }
 
-  Expression temp;
+  Answer temp;
   if (th1.joinable()) {
     in.push("%stop");
     out.wait_and_pop(temp);
@@ -135,12 +217,14 @@ int main(int argc, char *argv[]) {
 
   if (argc == 2) {
     return eval_from_file(argv[1]);
-  } else if (argc == 3) {
+  } else if (argc == 3 && std::string(argv[1]) == "-e") {
+    return eval_from_command(argv[2]);
+  } else if (argc > 2) {
     if (std::string(argv[1]) == "-e") {
-      return eval_from_command(argv[2]);
-    } else {
       error("Incorrect number of command line arguments.");
+      return EXIT_FAILURE;
     }
+    return eval_from_files(std::vector<std::string>(argv + 1, argv + argc));
   } else {
     repl();
   }
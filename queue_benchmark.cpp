@@ -0,0 +1,104 @@
+// Compares the throughput and latency of MessageQueue and RingBuffer
+// passing program strings between threads, as the REPL and Consumer do.
+//
+// usage: queue_benchmark [messages]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "MessageQueue.hpp"
+#include "RingBuffer.hpp"
+
+typedef std::chrono::steady_clock Clock;
+
+// both queues take a message by rvalue here so the comparison is of the queues
+void send(MessageQueue<std::string> &queue, std::string &&message) {
+  queue.push(message);
+}
+
+void send(RingBuffer<std::string> &queue, std::string &&message) {
+  queue.push(std::move(message));
+}
+
+// messages per second from producers threads to consumers threads
+template<typename Queue>
+double throughput(std::size_t messages, unsigned producers, unsigned consumers) {
+
+  Queue queue;
+  const std::string program = "(begin (define f (lambda (x) (* 2 x))) (f 21))";
+  std::size_t perProducer = messages / producers;
+  std::size_t perConsumer = perProducer * producers / consumers;
+
+  auto start = Clock::now();
+  std::vector<std::thread> threads;
+  for (unsigned p = 0; p < producers; ++p) {
+    threads.emplace_back([&]() {
+      for (std::size_t i = 0; i < perProducer; ++i)
+        send(queue, std::string(program));
+    });
+  }
+  for (unsigned c = 0; c < consumers; ++c) {
+    threads.emplace_back([&]() {
+      std::string message;
+      for (std::size_t i = 0; i < perConsumer; ++i)
+        queue.wait_and_pop(message);
+    });
+  }
+  for (auto &thread:threads)
+    thread.join();
+
+  return perConsumer * consumers / std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// median microseconds for a message to go to another thread and back
+template<typename Queue>
+double latency(std::size_t trips) {
+
+  Queue there, back;
+  std::thread echo([&]() {
+    std::string message;
+    for (std::size_t i = 0; i < trips; ++i) {
+      there.wait_and_pop(message);
+      send(back, std::move(message));
+    }
+  });
+
+  std::vector<double> times;
+  std::string message;
+  for (std::size_t i = 0; i < trips; ++i) {
+    auto start = Clock::now();
+    send(there, std::string("(+ 1 2)"));
+    back.wait_and_pop(message);
+    times.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+  }
+  echo.join();
+
+  std::nth_element(times.begin(), times.begin() + times.size() / 2, times.end());
+  return times[times.size() / 2];
+}
+
+int main(int argc, char *argv[]) {
+
+  std::size_t messages = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+
+  std::cout << "messages: " << messages << "\n\n";
+  std::cout << "threads (producers x consumers)   MessageQueue msg/s   RingBuffer msg/s\n";
+  unsigned shapes[][2] = {{1, 1}, {2, 2}, {4, 1}, {1, 4}};
+  for (auto &shape:shapes) {
+    std::cout << "  " << shape[0] << " x " << shape[1] << "                          "
+              << throughput<MessageQueue<std::string>>(messages, shape[0], shape[1]) << "        "
+              << throughput<RingBuffer<std::string>>(messages, shape[0], shape[1]) << "\n";
+  }
+
+  std::size_t trips = std::max<std::size_t>(messages / 100, 1);
+  std::cout << "\nmedian round trip (us)            "
+            << latency<MessageQueue<std::string>>(trips) << "             "
+            << latency<RingBuffer<std::string>>(trips) << "\n";
+
+  return EXIT_SUCCESS;
+}
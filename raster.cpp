@@ -0,0 +1,186 @@
+#include "raster.hpp"
+
+#include <QPainter>
+#include <QTextDocument>
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "geometry_item.hpp"
+
+namespace {
+
+// the primitives of a result: itself, or the elements of a list
+std::vector<const Expression *> graphicsOf(const Expression &result) {
+
+  std::vector<const Expression *> graphics;
+  if (result.isList() && !result.isPoint() && !result.isLine() && result.getGeometry() == nullptr) {
+    for (auto &item:result.getTail())
+      graphics.push_back(&item);
+  } else {
+    graphics.push_back(&result);
+  }
+  return graphics;
+}
+
+// the number of a property, or nullptr if it is not a number
+const Expression *numberProperty(const Expression &item, const std::string &key) {
+  const Expression *value = item.findProperty(key);
+  return (value != nullptr && value->isHeadNumber()) ? value : nullptr;
+}
+
+// the point diameter or line thickness of a packed Geometry
+double widthOf(const Expression &item) {
+  return item.findProperty(item.isPointCloud() ? "size" : "thickness")->head().asNumber();
+}
+
+double coordinate(const Expression &point, std::size_t index) {
+  return (point.getTail().cbegin() + index)->head().asNumber();
+}
+
+// lays out a text as QGraphicsTextItem does
+struct TextLayout {
+  QPointF center;
+  qreal scale = 1;
+  qreal rotation = 0;
+  QSizeF box;
+
+  explicit TextLayout(const Expression &text, QTextDocument &document) {
+    const Expression *position = text.findProperty("position");
+    center = QPointF(coordinate(*position, 0), coordinate(*position, 1));
+    const Expression *textScale = numberProperty(text, "text-scale");
+    if (textScale != nullptr)
+      scale = textScale->head().asNumber();
+    const Expression *textRotation = numberProperty(text, "text-rotation");
+    if (textRotation != nullptr)
+      rotation = textRotation->head().asNumber() * 180 / std::atan2(0, -1);
+    document.setPlainText(QString::fromStdString(text.head().asString()));
+    box = document.size();
+  }
+
+  // from the coordinates of the text box to the scene
+  QTransform transform() const {
+    QTransform transform;
+    transform.translate(center.x(), center.y());
+    transform.rotate(rotation);
+    transform.scale(scale, scale);
+    transform.translate(-box.width() / 2, -box.height() / 2);
+    return transform;
+  }
+};
+
+// the scene rectangle covered by a primitive, batch drawing it if it is packed
+QRectF boundsOf(const Expression &item, const GeometryItem *batch, QTextDocument &document) {
+
+  if (batch != nullptr) {
+    return batch->boundingRect();
+  } else if (item.isPoint()) {
+    double offset = item.findProperty("size")->head().asNumber() / 2;
+    return QRectF(coordinate(item, 0) - offset, coordinate(item, 1) - offset, 2 * offset, 2 * offset);
+  } else if (item.isLine()) {
+    const Expression &p1 = *item.getTail().cbegin();
+    const Expression &p2 = *(item.getTail().cbegin() + 1);
+    double pad = item.findProperty("thickness")->head().asNumber() / 2;
+    return QRectF(QPointF(coordinate(p1, 0), coordinate(p1, 1)), QPointF(coordinate(p2, 0), coordinate(p2, 1)))
+        .normalized().adjusted(-pad, -pad, pad, pad);
+  }
+  TextLayout layout(item, document);
+  return layout.transform().mapRect(QRectF(QPointF(0, 0), layout.box));
+}
+
+void draw(QPainter &painter, const Expression &item, GeometryItem *batch, QTextDocument &document) {
+
+  if (batch != nullptr) {
+    batch->paint(&painter, nullptr, nullptr);
+  } else if (item.isPoint()) {
+    double radius = item.findProperty("size")->head().asNumber() / 2;
+    painter.setPen(Qt::NoPen);
+    painter.setBrush(QBrush(Qt::black, Qt::SolidPattern));
+    painter.drawEllipse(QPointF(coordinate(item, 0), coordinate(item, 1)), radius, radius);
+  } else if (item.isLine()) {
+    const Expression &p1 = *item.getTail().cbegin();
+    const Expression &p2 = *(item.getTail().cbegin() + 1);
+    painter.setPen(QPen(QBrush(Qt::black, Qt::SolidPattern), item.findProperty("thickness")->head().asNumber()));
+    painter.drawLine(QLineF(coordinate(p1, 0), coordinate(p1, 1), coordinate(p2, 0), coordinate(p2, 1)));
+  } else {
+    TextLayout layout(item, document);
+    painter.save();
+    painter.setTransform(layout.transform(), true);
+    document.drawContents(&painter);
+    painter.restore();
+  }
+}
+
+}
+
+std::size_t countPrimitives(const Expression &result) {
+
+  std::size_t count = 0;
+  for (const Expression *item:graphicsOf(result)) {
+    if (item->getGeometry() != nullptr) {
+      if (numberProperty(*item, item->isPointCloud() ? "size" : "thickness") == nullptr)
+        return 0;
+      count += item->getGeometry()->size();
+    } else if (item->isPoint()) {
+      if (numberProperty(*item, "size") == nullptr)
+        return 0;
+      count++;
+    } else if (item->isLine()) {
+      if (numberProperty(*item, "thickness") == nullptr)
+        return 0;
+      count++;
+    } else if (item->isText()) {
+      const Expression *position = item->findProperty("position");
+      if (position == nullptr || !position->isPoint())
+        return 0;
+      count++;
+    } else {
+      return 0;
+    }
+  }
+
+  return count;
+}
+
+QImage rasterize(const Expression &result, const QSize &size, qreal ratio) {
+
+  QImage image(size * ratio, QImage::Format_ARGB32_Premultiplied);
+  image.setDevicePixelRatio(ratio);
+  image.fill(Qt::white);
+  if (size.isEmpty())
+    return image;
+
+  auto graphics = graphicsOf(result);
+  QTextDocument document;
+
+  /// Convert each packed Geometry once, for its bounds and its drawing
+  std::vector<std::unique_ptr<GeometryItem>> batches(graphics.size());
+  for (std::size_t i = 0; i < graphics.size(); ++i) {
+    if (graphics[i]->getGeometry() != nullptr)
+      batches[i].reset(new GeometryItem(*graphics[i]->getGeometry(), widthOf(*graphics[i])));
+  }
+
+  QRectF bounds;
+  for (std::size_t i = 0; i < graphics.size(); ++i)
+    bounds |= boundsOf(*graphics[i], batches[i].get(), document);
+  if (bounds.width() <= 0)
+    bounds.adjust(-1, 0, 1, 0);
+  if (bounds.height() <= 0)
+    bounds.adjust(0, -1, 0, 1);
+
+  /// Fit the bounds keeping the aspect ratio, as QGraphicsView::fitInView does
+  QRectF target = QRectF(QPointF(0, 0), QSizeF(size)).adjusted(2, 2, -2, -2);
+  qreal scale = std::min(target.width() / bounds.width(), target.height() / bounds.height());
+
+  QPainter painter(&image);
+  painter.setRenderHint(QPainter::Antialiasing);
+  painter.translate(target.center());
+  painter.scale(scale, scale);
+  painter.translate(-bounds.center());
+
+  for (std::size_t i = 0; i < graphics.size(); ++i)
+    draw(painter, *graphics[i], batches[i].get(), document);
+
+  return image;
+}
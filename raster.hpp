@@ -0,0 +1,32 @@
+/*! \file raster.hpp
+Defines the drawing of graphic results into images, off the GUI thread.
+ */
+#ifndef PLOTSCRIPT_RASTER_HPP
+#define PLOTSCRIPT_RASTER_HPP
+
+#include <QImage>
+#include <QSize>
+#include <cstddef>
+
+#include "expression.hpp"
+
+/*! Count the points, lines and texts a graphic result draws.
+
+  A packed Geometry counts each of its primitives. A result that is not
+  graphic, or that has a primitive with a missing or invalid style, counts
+  0 so the scene reports its error.
+ */
+std::size_t countPrimitives(const Expression &result);
+
+/*! Draw a graphic result into an image, as the output scene would show it
+  fitted to the image.
+
+  Only Qt types safe outside the GUI thread are used, so the image may be
+  drawn on any thread.
+  \param result the graphic result
+  \param size the size of the image in device independent pixels
+  \param ratio the device pixel ratio of the screen the image is shown on
+ */
+QImage rasterize(const Expression &result, const QSize &size, qreal ratio);
+
+#endif //PLOTSCRIPT_RASTER_HPP
@@ -0,0 +1,68 @@
+#include "catch.hpp"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "RingBuffer.hpp"
+
+TEST_CASE("Test ring buffer capacity", "[ring buffer]") {
+
+  RingBuffer<std::string> queue(3);
+  REQUIRE(queue.capacity() == 4);
+  REQUIRE(queue.empty());
+
+  for (int i = 0; i < 4; ++i)
+    REQUIRE(queue.try_push(std::to_string(i)));
+
+  /// a full queue leaves the message with the caller
+  std::string message("4");
+  REQUIRE_FALSE(queue.try_push(std::move(message)));
+  REQUIRE(message == "4");
+
+  std::string popped;
+  REQUIRE(queue.try_pop(popped));
+  REQUIRE(popped == "0");
+  REQUIRE(queue.try_push(std::move(message)));
+
+  std::vector<std::string> batch(8);
+  REQUIRE(queue.pop_n(batch.data(), batch.size()) == 4);
+  REQUIRE(batch[0] == "1");
+  REQUIRE(batch[3] == "4");
+  REQUIRE(queue.empty());
+  REQUIRE_FALSE(queue.try_pop(popped));
+
+  REQUIRE(queue.push_n(batch.data(), batch.size()) == 4);
+  REQUIRE(queue.try_pop(popped));
+  REQUIRE(popped == "1");
+}
+
+TEST_CASE("Test ring buffer across threads", "[ring buffer]") {
+
+  RingBuffer<std::size_t> queue(16);
+  const std::size_t count = 100000;
+
+  /// two producers each push every number once, blocking when the queue is full
+  std::vector<std::thread> producers;
+  for (int p = 0; p < 2; ++p) {
+    producers.emplace_back([&queue, count]() {
+      for (std::size_t i = 0; i < count; ++i)
+        queue.push(std::size_t(i));
+    });
+  }
+
+  std::vector<std::size_t> seen(count, 0);
+  std::size_t value;
+  for (std::size_t i = 0; i < 2 * count; ++i) {
+    queue.wait_and_pop(value);
+    seen[value]++;
+  }
+  for (auto &producer:producers)
+    producer.join();
+
+  bool twice = true;
+  for (auto times:seen)
+    twice = twice && times == 2;
+  REQUIRE(twice);
+  REQUIRE(queue.empty());
+}
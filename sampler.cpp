@@ -0,0 +1,162 @@
+#include "sampler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <list>
+
+namespace {
+
+// a sample of the curve, depth counts how often the segment to the next
+// sample has been halved
+struct Sample {
+  double x;
+  double y;
+  std::size_t depth;
+  bool split;
+  bool queued;
+
+  Sample(double xValue, double yValue, std::size_t segmentDepth)
+      : x(xValue), y(yValue), depth(segmentDepth), split(false), queued(false) {}
+};
+
+typedef std::list<Sample> Curve;
+
+// scale factor that maps the sampled interval onto the 20 unit plot box
+double plotScale(double min, double max) {
+  double extent = max - min;
+  return (std::isfinite(extent) && extent > 0) ? 20 / extent : 1;
+}
+
+}
+
+AdaptiveSampler::AdaptiveSampler(const SamplerOptions &options) : m_options(options) {
+  if (m_options.initialSegments == 0)
+    m_options.initialSegments = 1;
+}
+
+void AdaptiveSampler::sample(const BatchFunction &function, double lower, double upper,
+                             std::vector<double> &x, std::vector<double> &y,
+                             const SampleProgress &progress) {
+
+  m_evaluations = 0;
+  m_passes = 0;
+
+  /// Evenly sample the interval
+  std::size_t segments = m_options.initialSegments;
+  std::vector<double> batchX(segments + 1);
+  std::vector<double> batchY;
+  for (std::size_t i = 0; i < segments; ++i)
+    batchX[i] = lower + (upper - lower) * i / segments;
+  batchX[segments] = upper;
+
+  function(batchX, batchY);
+  m_evaluations += batchX.size();
+
+  Curve curve;
+  for (std::size_t i = 0; i < batchX.size(); ++i)
+    curve.emplace_back(batchX[i], batchY[i], 0);
+
+  auto collect = [&curve, &x, &y]() {
+    x.clear();
+    y.clear();
+    x.reserve(curve.size());
+    y.reserve(curve.size());
+    for (auto &point:curve) {
+      x.push_back(point.x);
+      y.push_back(point.y);
+    }
+  };
+
+  double scale = plotScale(std::min(lower, upper), std::max(lower, upper));
+  const double degrees = 180 / std::atan2(0, -1);
+
+  /// Every interior sample is checked on the first pass
+  std::vector<Curve::iterator> worklist;
+  for (auto it = curve.begin(); it != curve.end(); ++it) {
+    it->queued = true;
+    worklist.push_back(it);
+  }
+
+  auto queue = [&](Curve::iterator it) {
+    if (it != curve.end() && !it->queued) {
+      it->queued = true;
+      worklist.push_back(it);
+    }
+  };
+
+  std::vector<Curve::iterator> splits;
+  auto mark = [&](Curve::iterator it) {
+    if (!it->split && it->depth < m_options.maxDepth && m_evaluations + splits.size() < m_options.budget) {
+      it->split = true;
+      splits.push_back(it);
+    }
+  };
+
+  /// Refine until the curve is smooth, too deep, or the budget is spent
+  while (!worklist.empty() && m_evaluations < m_options.budget) {
+    splits.clear();
+    for (auto vertex:worklist) {
+      vertex->queued = false;
+      if (vertex == curve.begin() || std::next(vertex) == curve.end())
+        continue;
+      auto before = std::prev(vertex);
+      auto after = std::next(vertex);
+
+      double ux = (vertex->x - before->x) * scale, uy = (vertex->y - before->y) * scale;
+      double vx = (after->x - vertex->x) * scale, vy = (after->y - vertex->y) * scale;
+      double turn = std::atan2(std::abs(ux * vy - uy * vx), ux * vx + uy * vy) * degrees;
+      if (!std::isfinite(turn) || turn <= m_options.angleTolerance)
+        continue;
+
+      if (m_options.errorTolerance > 0) {
+        double cx = ux + vx, cy = uy + vy;
+        double chord = std::hypot(cx, cy);
+        if (chord > 0 && std::abs(cx * uy - cy * ux) / chord <= m_options.errorTolerance)
+          continue;
+      }
+
+      mark(before);
+      mark(vertex);
+    }
+    worklist.clear();
+
+    if (splits.empty())
+      break;
+    ++m_passes;
+
+    /// The curve so far is final unless this pass refines it
+    if (progress) {
+      collect();
+      progress(x, y);
+    }
+
+    /// Evaluate every midpoint of this pass at once
+    batchX.resize(splits.size());
+    for (std::size_t i = 0; i < splits.size(); ++i)
+      batchX[i] = (splits[i]->x + std::next(splits[i])->x) / 2;
+    function(batchX, batchY);
+    m_evaluations += batchX.size();
+
+    for (std::size_t i = 0; i < splits.size(); ++i) {
+      auto start = splits[i];
+      auto end = std::next(start);
+      start->split = false;
+      start->depth++;
+      auto middle = curve.emplace(end, batchX[i], batchY[i], start->depth);
+      queue(start);
+      queue(middle);
+      queue(end);
+    }
+  }
+
+  collect();
+}
+
+std::size_t AdaptiveSampler::evaluations() const noexcept {
+  return m_evaluations;
+}
+
+std::size_t AdaptiveSampler::passes() const noexcept {
+  return m_passes;
+}
@@ -0,0 +1,89 @@
+/*! \file sampler.hpp
+Defines the adaptive sampler used to build continuous plots.
+ */
+#ifndef SAMPLER_HPP
+#define SAMPLER_HPP
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+/*! \struct SamplerOptions
+\brief Tuning parameters for the AdaptiveSampler.
+
+Both axes are scaled by the factor that maps the sampled interval onto the
+20 unit plot box, so angles are those of the function itself and distances
+are in plot units along the abscissa.
+ */
+struct SamplerOptions {
+  /// number of evenly spaced segments sampled before any refinement
+  std::size_t initialSegments = 50;
+
+  /// maximum number of times a segment of the initial sampling may be halved
+  std::size_t maxDepth = 10;
+
+  /// maximum number of function evaluations, including the initial samples
+  std::size_t budget = 2000;
+
+  /// a vertex bending by more than this many degrees has its segments split
+  double angleTolerance = 5;
+
+  /// a vertex closer than this to the chord of its neighbours is never split
+  double errorTolerance = 0;
+};
+
+/*! \typedef BatchFunction
+\brief Evaluates a function at every abscissa of the first argument,
+       writing the ordinates into the second argument.
+*/
+typedef std::function<void(const std::vector<double> &x, std::vector<double> &y)> BatchFunction;
+
+/*! \typedef SampleProgress
+\brief Receives the abscissas and ordinates of the curve sampled so far.
+*/
+typedef std::function<void(const std::vector<double> &x, const std::vector<double> &y)> SampleProgress;
+
+/*! \class AdaptiveSampler
+\brief Samples a function over an interval, refining only where the curve bends.
+
+The interval is first sampled evenly. Each pass then visits only the vertices
+next to points added by the previous pass, splits the segments that bend by
+more than the angle tolerance, and evaluates all of the new midpoints in one
+batch. Points are kept in a linked list so that insertion is constant time,
+and the total work is linear in the number of points produced.
+ */
+class AdaptiveSampler {
+ public:
+
+  /// Construct a sampler with the given options
+  explicit AdaptiveSampler(const SamplerOptions &options = SamplerOptions());
+
+  /*! Sample a function over an interval.
+    \param function the function to sample
+    \param lower the first abscissa
+    \param upper the last abscissa
+    \param x receives the abscissas of the refined curve in increasing order
+    \param y receives the ordinates of the refined curve
+    \param progress if set, called with the curve after the even sampling and
+           after each refinement pass but the last
+   */
+  void sample(const BatchFunction &function, double lower, double upper,
+              std::vector<double> &x, std::vector<double> &y,
+              const SampleProgress &progress = SampleProgress());
+
+  /// number of function evaluations performed by the last call to sample
+  std::size_t evaluations() const noexcept;
+
+  /// number of refinement passes performed by the last call to sample
+  std::size_t passes() const noexcept;
+
+ private:
+
+  SamplerOptions m_options;
+
+  std::size_t m_evaluations = 0;
+
+  std::size_t m_passes = 0;
+};
+
+#endif
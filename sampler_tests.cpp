@@ -0,0 +1,118 @@
+#include "catch.hpp"
+
+#include "sampler.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+TEST_CASE("Test sampler leaves a straight line alone", "[sampler]") {
+
+  std::size_t calls = 0;
+  BatchFunction line = [&calls](const std::vector<double> &x, std::vector<double> &y) {
+    calls++;
+    y.resize(x.size());
+    for (std::size_t i = 0; i < x.size(); ++i)
+      y[i] = 2 * x[i] + 1;
+  };
+
+  AdaptiveSampler sampler;
+  std::vector<double> x, y;
+  sampler.sample(line, -2, 2, x, y);
+
+  REQUIRE(x.size() == 51);
+  REQUIRE(y.size() == 51);
+  REQUIRE(x.front() == -2);
+  REQUIRE(x.back() == 2);
+  REQUIRE(sampler.evaluations() == 51);
+  REQUIRE(sampler.passes() == 0);
+  REQUIRE(calls == 1);
+}
+
+TEST_CASE("Test sampler refines a curve", "[sampler]") {
+
+  BatchFunction sine = [](const std::vector<double> &x, std::vector<double> &y) {
+    y.resize(x.size());
+    for (std::size_t i = 0; i < x.size(); ++i)
+      y[i] = std::sin(x[i]);
+  };
+
+  AdaptiveSampler sampler;
+  std::vector<double> x, y;
+  sampler.sample(sine, -std::atan2(0, -1), std::atan2(0, -1), x, y);
+
+  REQUIRE(x.size() > 51);
+  REQUIRE(x.size() == sampler.evaluations());
+  REQUIRE(sampler.passes() > 0);
+  REQUIRE(std::is_sorted(x.cbegin(), x.cend()));
+  for (std::size_t i = 0; i < x.size(); ++i)
+    REQUIRE(y[i] == std::sin(x[i]));
+}
+
+TEST_CASE("Test sampler respects its budget and depth", "[sampler]") {
+
+  BatchFunction step = [](const std::vector<double> &x, std::vector<double> &y) {
+    y.resize(x.size());
+    for (std::size_t i = 0; i < x.size(); ++i)
+      y[i] = x[i] < 0.01 ? 0 : 1;
+  };
+
+  {
+    SamplerOptions options;
+    options.budget = 60;
+    AdaptiveSampler sampler(options);
+    std::vector<double> x, y;
+    sampler.sample(step, -1, 1, x, y);
+    REQUIRE(sampler.evaluations() <= 60);
+    REQUIRE(x.size() == sampler.evaluations());
+  }
+  {
+    SamplerOptions options;
+    options.maxDepth = 2;
+    AdaptiveSampler sampler(options);
+    std::vector<double> x, y;
+    sampler.sample(step, -1, 1, x, y);
+    REQUIRE(sampler.passes() <= 2);
+  }
+  {
+    SamplerOptions options;
+    options.angleTolerance = 180;
+    AdaptiveSampler sampler(options);
+    std::vector<double> x, y;
+    sampler.sample(step, -1, 1, x, y);
+    REQUIRE(sampler.evaluations() == 51);
+  }
+}
+
+TEST_CASE("Test sampler reports its progress", "[sampler]") {
+
+  BatchFunction sine = [](const std::vector<double> &x, std::vector<double> &y) {
+    y.resize(x.size());
+    for (std::size_t i = 0; i < x.size(); ++i)
+      y[i] = std::sin(x[i]);
+  };
+
+  std::vector<std::size_t> sizes;
+  SampleProgress progress = [&sizes](const std::vector<double> &x, const std::vector<double> &y) {
+    REQUIRE(x.size() == y.size());
+    REQUIRE(std::is_sorted(x.cbegin(), x.cend()));
+    sizes.push_back(x.size());
+  };
+
+  AdaptiveSampler sampler;
+  std::vector<double> x, y;
+  sampler.sample(sine, -std::atan2(0, -1), std::atan2(0, -1), x, y, progress);
+
+  /// The even sampling first, then the curve before each later pass
+  REQUIRE(sizes.size() == sampler.passes());
+  REQUIRE(sizes.front() == 51);
+  REQUIRE(std::is_sorted(sizes.cbegin(), sizes.cend()));
+  REQUIRE(sizes.back() < x.size());
+
+  /// A straight line needs no refinement and reports nothing
+  BatchFunction line = [](const std::vector<double> &x, std::vector<double> &y) {
+    y.assign(x.cbegin(), x.cend());
+  };
+  sizes.clear();
+  sampler.sample(line, -2, 2, x, y, progress);
+  REQUIRE(sizes.empty());
+}
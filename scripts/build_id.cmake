@@ -0,0 +1,26 @@
+# Writes OUTPUT, a header defining BUILD_ID as the SHA-256 of the COMPILER
+# description and of every file in SOURCES, relative to SOURCE_DIR. Any change
+# to the interpreter sources or the way they are compiled changes the id.
+set(description "${COMPILER}")
+foreach (source ${SOURCES})
+    file(SHA256 ${SOURCE_DIR}/${source} hash)
+    set(description "${description}\n${source} ${hash}")
+endforeach ()
+string(SHA256 id "${description}")
+
+set(content "#ifndef BUILD_ID_HPP
+#define BUILD_ID_HPP
+
+// generated by scripts/build_id.cmake from the interpreter sources and compiler
+const char BUILD_ID[] = \"${id}\";
+
+#endif
+")
+
+# rewrite only on change so that nothing is rebuilt needlessly
+if (EXISTS ${OUTPUT})
+    file(READ ${OUTPUT} previous)
+endif ()
+if (NOT "${previous}" STREQUAL "${content}")
+    file(WRITE ${OUTPUT} "${content}")
+endif ()
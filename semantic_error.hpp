@@ -17,4 +17,28 @@ class SemanticError : public std::runtime_error {
   SemanticError(const std::string &message) : std::runtime_error(message) {};
 };
 
+/*! \class Interrupted
+\brief Exception thrown when an evaluation is stopped before it completes
+
+Handlers that add context to a SemanticError rethrow it unchanged.
+ */
+class Interrupted : public SemanticError {
+ public:
+  /// Construct an exception with the message "Error: interrupted"
+  Interrupted() : SemanticError("Error: interrupted") {};
+
+ protected:
+  /// Construct an exeption with a given message
+  Interrupted(const std::string &message) : SemanticError(message) {};
+};
+
+/*! \class LimitExceeded
+\brief Exception thrown when an evaluation exceeds one of its resource limits
+ */
+class LimitExceeded : public Interrupted {
+ public:
+  /// Construct an exeption with a given message
+  LimitExceeded(const std::string &message) : Interrupted(message) {};
+};
+
 #endif
@@ -0,0 +1,52 @@
+#include "sequence.hpp"
+
+#include <cmath>
+#include <limits>
+#include <utility>
+
+PackedSequence::PackedSequence(std::vector<double> &&values) : m_values(std::move(values)) {}
+
+std::size_t PackedSequence::size() const noexcept {
+  return m_values.size();
+}
+
+double PackedSequence::at(std::size_t index) const noexcept {
+  return m_values[index];
+}
+
+SliceSequence::SliceSequence(const std::shared_ptr<const Sequence> &base, std::size_t offset, std::size_t count)
+    : m_base(base), m_offset(offset), m_count(count) {}
+
+std::size_t SliceSequence::size() const noexcept {
+  return m_count;
+}
+
+double SliceSequence::at(std::size_t index) const noexcept {
+  return m_base->at(m_offset + index);
+}
+
+RangeSequence::RangeSequence(double start, double stop, double step) : m_start(start), m_step(step), m_count(0) {
+
+  if (!(start <= stop))
+    return;
+
+  // count the whole steps from start to stop, then correct the count where
+  // rounding puts the value at() computes for an end of it on the wrong side
+  // of stop. The upward correction needs the next value to differ, since a
+  // step below the precision of a large value no longer moves it.
+  double steps = std::floor((stop - start) / step);
+  const double largest = static_cast<double>(std::numeric_limits<std::size_t>::max() / 2);
+  m_count = steps < largest ? static_cast<std::size_t>(steps) + 1 : static_cast<std::size_t>(largest);
+  while (m_count > 0 && at(m_count - 1) > stop)
+    m_count--;
+  while (m_count > 0 && at(m_count) <= stop && at(m_count) > at(m_count - 1))
+    m_count++;
+}
+
+std::size_t RangeSequence::size() const noexcept {
+  return m_count;
+}
+
+double RangeSequence::at(std::size_t index) const noexcept {
+  return m_start + index * m_step;
+}
@@ -0,0 +1,97 @@
+/*! \file sequence.hpp
+Defines the Sequence type, a numeric list whose elements are produced on demand.
+ */
+#ifndef SEQUENCE_HPP
+#define SEQUENCE_HPP
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+/*! \class Sequence
+\brief Interface to a read-only list of numbers that is not stored as Expressions.
+
+An Expression backed by a Sequence is a list whose elements are only turned
+into Expressions when its tail is accessed. Procedures that only need the
+numbers read them through the Sequence directly. Implementations must be
+immutable so that a Sequence can be shared between copies and threads.
+ */
+class Sequence {
+ public:
+
+  virtual ~Sequence() = default;
+
+  /// the number of elements
+  virtual std::size_t size() const noexcept = 0;
+
+  /// the element at index, which must be less than size()
+  virtual double at(std::size_t index) const noexcept = 0;
+};
+
+/*! \class PackedSequence
+\brief A Sequence over numbers held in one contiguous array.
+ */
+class PackedSequence : public Sequence {
+ public:
+
+  /// Construct a sequence taking ownership of the values
+  explicit PackedSequence(std::vector<double> &&values);
+
+  std::size_t size() const noexcept override;
+
+  double at(std::size_t index) const noexcept override;
+
+ private:
+
+  std::vector<double> m_values;
+};
+
+/*! \class SliceSequence
+\brief A Sequence over a contiguous part of another Sequence.
+ */
+class SliceSequence : public Sequence {
+ public:
+
+  /// Construct a sequence of count elements of base starting at offset
+  SliceSequence(const std::shared_ptr<const Sequence> &base, std::size_t offset, std::size_t count);
+
+  std::size_t size() const noexcept override;
+
+  double at(std::size_t index) const noexcept override;
+
+ private:
+
+  std::shared_ptr<const Sequence> m_base;
+
+  std::size_t m_offset;
+
+  std::size_t m_count;
+};
+
+/*! \class RangeSequence
+\brief An arithmetic Sequence of evenly spaced numbers, computed when read.
+ */
+class RangeSequence : public Sequence {
+ public:
+
+  /*! Construct the sequence start, start + step, ... up to and including stop.
+    \param start the first number
+    \param stop the largest number that may be included
+    \param step the positive distance between numbers
+   */
+  RangeSequence(double start, double stop, double step);
+
+  std::size_t size() const noexcept override;
+
+  double at(std::size_t index) const noexcept override;
+
+ private:
+
+  double m_start;
+
+  double m_step;
+
+  std::size_t m_count;
+};
+
+#endif